@@ -0,0 +1,138 @@
+#include "batch_controller.hpp"
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+namespace {
+
+/// Number of batches per active writer in a single measurement window.
+const size_t kWindowBatchesPerWriter = 8;
+
+/// Factor by which the batch size is changed in a single step.
+const double kBatchSizeStep = 1.5;
+
+/// Relative throughput change that's considered to be noise.
+const double kThroughputTolerance = 0.05;
+
+double ToSeconds(std::chrono::nanoseconds duration) {
+  return std::chrono::duration<double>(duration).count();
+}
+
+}  // namespace
+
+BatchController::BatchController(const Options &options)
+    : options_(options),
+      batch_size_(std::clamp(options.initial_batch_size,
+                             options.min_batch_size, options.max_batch_size)),
+      writers_(options.max_writers) {
+  CHECK(options_.min_batch_size > 0 &&
+        options_.min_batch_size <= options_.max_batch_size)
+      << "Invalid range of batch sizes!";
+  CHECK(options_.max_writers > 0) << "Number of writers should be positive!";
+}
+
+bool BatchController::Observe(size_t rows, size_t bytes,
+                              std::chrono::nanoseconds latency,
+                              size_t conflicts) {
+  std::lock_guard<std::mutex> guard(lock_);
+  for (auto *sample : {&window_, &summary_}) {
+    ++sample->batches;
+    sample->rows += rows;
+    sample->bytes += bytes;
+    sample->conflicts += conflicts;
+    sample->latency += latency;
+  }
+  if (window_.batches < kWindowBatchesPerWriter * writers_) {
+    return false;
+  }
+  const auto changed = Adjust(window_);
+  window_ = Sample();
+  return changed;
+}
+
+bool BatchController::Adjust(const Sample &window) {
+  const auto elapsed = std::chrono::steady_clock::now() - window.start;
+  const auto throughput = window.rows / std::max(ToSeconds(elapsed), 1e-9);
+  const auto average_latency = window.latency / window.batches;
+  size_t batch_size = batch_size_;
+  size_t writers = writers_;
+
+  if (window.conflicts > 0 || average_latency > options_.latency_budget) {
+    // Back off right away, and start probing again from the smaller size.
+    batch_size = batch_size / 2;
+    if (window.conflicts > 0 && writers > 1 && !writers_fixed_) {
+      --writers;
+    }
+    tune_writers_ = false;
+    increase_ = true;
+  } else {
+    const bool worse =
+        throughput < last_throughput_ * (1 - kThroughputTolerance);
+    if (worse) {
+      // The last step made things worse, so it's reverted by stepping in the
+      // opposite direction, and the other dimension is tuned next.
+      increase_ = !increase_;
+    }
+    if (tune_writers_) {
+      writers = increase_ ? writers + 1 : writers - 1;
+    } else {
+      batch_size = static_cast<size_t>(increase_ ? batch_size * kBatchSizeStep
+                                                 : batch_size / kBatchSizeStep);
+    }
+    if (worse) {
+      tune_writers_ =
+          !tune_writers_ && options_.max_writers > 1 && !writers_fixed_;
+    }
+  }
+  last_throughput_ = throughput;
+
+  writers = std::clamp<size_t>(writers, 1, options_.max_writers);
+  // Uncommitted transactions of all writers should fit the memory budget.
+  auto max_batch_size = options_.max_batch_size;
+  if (window.bytes > 0) {
+    const auto row_bytes = std::max<size_t>(window.bytes / window.rows, 1);
+    const auto uncommitted_batches = options_.transaction_batches * writers;
+    max_batch_size = std::min(
+        max_batch_size, options_.memory_budget /
+                            (row_bytes * uncommitted_batches));
+  }
+  batch_size = std::clamp(batch_size, options_.min_batch_size,
+                          std::max(max_batch_size, options_.min_batch_size));
+
+  DLOG(INFO) << "Batches took " << ToSeconds(average_latency)
+             << "s on average, " << throughput << " rows/s, "
+             << window.conflicts << " conflicts; next batch size is "
+             << batch_size << " with " << writers << " writers";
+  const bool writers_changed = writers != writers_;
+  batch_size_ = batch_size;
+  writers_ = writers;
+  return writers_changed;
+}
+
+void BatchController::FixWriters() {
+  if (writers_fixed_) {
+    return;
+  }
+  std::lock_guard<std::mutex> guard(lock_);
+  writers_fixed_ = true;
+  writers_ = options_.max_writers;
+  tune_writers_ = false;
+}
+
+void BatchController::LogSummary(const std::string &name) {
+  std::lock_guard<std::mutex> guard(lock_);
+  if (summary_.batches > 0) {
+    const auto elapsed = std::chrono::steady_clock::now() - summary_.start;
+    LOG(INFO) << name << ": " << summary_.rows << " rows in "
+              << ToSeconds(elapsed) << "s ("
+              << summary_.rows / std::max(ToSeconds(elapsed), 1e-9)
+              << " rows/s), " << summary_.conflicts
+              << " conflicts; tuned settings: --batch-size=" << batch_size_
+              << (writers_fixed_ ? ""
+                                 : " --destination-connections=" +
+                                       std::to_string(writers_));
+  }
+  summary_ = Sample();
+  writers_fixed_ = false;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+
+/// Adjusts the number of rows per batch and the number of active writers to
+/// maximize the number of rows written per second. The controller measures
+/// latency, size and conflicts of the written batches over windows of a few
+/// batches. After each window it takes a step in one of the two dimensions,
+/// and keeps going in the same direction as long as the throughput improves.
+/// Batches that take longer than the latency budget, or that conflict with
+/// other transactions, halve the batch size. The batch size is also capped so
+/// that the estimated size of all uncommitted transactions stays within the
+/// destination memory budget.
+class BatchController {
+ public:
+  struct Options {
+    size_t initial_batch_size{1000};
+    size_t min_batch_size{10};
+    size_t max_batch_size{100000};
+    size_t max_writers{1};
+    /// Number of batches committed by a single transaction.
+    size_t transaction_batches{1};
+    std::chrono::milliseconds latency_budget{500};
+    /// Estimated size in bytes of all uncommitted transactions.
+    size_t memory_budget{256 * 1024 * 1024};
+  };
+
+  explicit BatchController(const Options &options);
+
+  BatchController(const BatchController &) = delete;
+  BatchController(BatchController &&) = delete;
+  BatchController &operator=(const BatchController &) = delete;
+  BatchController &operator=(BatchController &&) = delete;
+
+  size_t batch_size() const { return batch_size_; }
+
+  size_t writers() const { return writers_; }
+
+  /// Records a written batch of `rows` rows, with an estimated size of `bytes`
+  /// bytes, which took `latency` to write and caused `conflicts` retries.
+  /// Returns true if the number of active writers was changed.
+  bool Observe(size_t rows, size_t bytes, std::chrono::nanoseconds latency,
+               size_t conflicts);
+
+  /// Activates all writers and stops tuning their number until the next
+  /// summary. It's used while batches are written to explicit lanes, because
+  /// parked writers still write batches of their own lanes, so the number of
+  /// active writers has no effect on them.
+  void FixWriters();
+
+  /// Logs the throughput and the settings used since the last summary, e.g.
+  /// for a single table, so they can be reused by later runs. The number of
+  /// writers is only logged if it was tuned.
+  void LogSummary(const std::string &name);
+
+ private:
+  struct Sample {
+    size_t batches{0};
+    size_t rows{0};
+    size_t bytes{0};
+    size_t conflicts{0};
+    std::chrono::nanoseconds latency{0};
+    std::chrono::steady_clock::time_point start{
+        std::chrono::steady_clock::now()};
+  };
+
+  /// Takes a step after a full `window`. Returns true if the number of active
+  /// writers was changed.
+  bool Adjust(const Sample &window);
+
+  Options options_;
+  std::atomic<size_t> batch_size_;
+  std::atomic<size_t> writers_;
+
+  std::mutex lock_;
+  Sample window_;
+  Sample summary_;
+  double last_throughput_{0};
+  /// Whether the current dimension is the number of writers, and whether it's
+  /// being increased.
+  bool tune_writers_{false};
+  bool increase_{true};
+  /// Whether the number of writers is fixed until the next summary.
+  std::atomic<bool> writers_fixed_{false};
+};
@@ -0,0 +1,457 @@
+#include "batch_writer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <functional>
+
+#include <glog/logging.h>
+
+namespace {
+
+/// Returns true if the `error` is caused by a conflict with another
+/// transaction. Other errors, including unknown ones, aren't retried, because
+/// the transaction might have been committed before the error occurred, e.g.
+/// if the connection broke while waiting for the result.
+bool IsConflictError(const std::string &error) {
+  return error.find("conflicting transactions") != std::string::npos ||
+         error.find("Serialization") != std::string::npos;
+}
+
+/// Returns how long to wait before the given retry `attempt`, starting at
+/// 10ms and doubling up to a limit of 640ms.
+std::chrono::milliseconds GetRetryBackoff(size_t attempt) {
+  return std::chrono::milliseconds(10 << std::min<size_t>(attempt, 6));
+}
+
+/// Returns a hash of the node matched by the `label` and `size` row values
+/// starting at the `begin` position.
+size_t HashNodeKey(const std::string &label, const mg::List &row, size_t begin,
+                   size_t size) {
+  size_t hash = std::hash<std::string>{}(label);
+  const auto combine = [&hash](size_t value) {
+    hash ^= value + 0x9e3779b97f4a7c15 + (hash << 6) + (hash >> 2);
+  };
+  for (size_t i = begin; i < begin + size; ++i) {
+    const auto value = row[i];
+    combine(static_cast<size_t>(value.type()));
+    switch (value.type()) {
+      case mg::Value::Type::Bool:
+        combine(value.ValueBool());
+        break;
+      case mg::Value::Type::Int:
+        combine(std::hash<int64_t>{}(value.ValueInt()));
+        break;
+      case mg::Value::Type::Double:
+        combine(std::hash<double>{}(value.ValueDouble()));
+        break;
+      case mg::Value::Type::String:
+        combine(std::hash<std::string_view>{}(value.ValueString()));
+        break;
+      default:
+        // Other types aren't used as keys, so they're hashed by type only.
+        break;
+    }
+  }
+  return hash;
+}
+
+}  // namespace
+
+WriterPool::WriterPool(std::vector<std::unique_ptr<MemgraphClient>> clients,
+                       const BatchOptions &options, CreatedCallback callback,
+                       NodeIdsCallback node_ids_callback)
+    : options_(options),
+      callback_(std::move(callback)),
+      node_ids_callback_(std::move(node_ids_callback)),
+      workers_(clients.size()),
+      queue_capacity_(std::max(options.window, clients.size())) {
+  CHECK(!clients.empty()) << "Writer pool needs at least one connection!";
+  CHECK(options_.transaction_batches > 0)
+      << "Number of batches per transaction should be a positive number!";
+  for (size_t i = 0; i < clients.size(); ++i) {
+    workers_[i].index = i;
+    workers_[i].client = std::move(clients[i]);
+  }
+  if (options_.window == 0 && workers_.size() == 1) {
+    // Batches are written synchronously by the caller.
+    return;
+  }
+  for (auto &worker : workers_) {
+    worker.thread = std::thread([this, &worker] { Run(&worker); });
+  }
+}
+
+WriterPool::~WriterPool() {
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    closed_ = true;
+    has_task_.notify_all();
+  }
+  for (auto &worker : workers_) {
+    if (worker.thread.joinable()) {
+      worker.thread.join();
+    }
+    CHECK(!worker.in_transaction)
+        << "Writer pool destroyed before being synced!";
+  }
+}
+
+void WriterPool::Write(WriteBatch batch, size_t lane) {
+  if (monitor_ != nullptr) {
+    monitor_->WaitForMemory();
+  }
+  if (!workers_[0].thread.joinable()) {
+    ExecuteMeasured(&workers_[0], std::move(batch));
+    return;
+  }
+  auto *queue = &queue_;
+  if (lane != kAnyLane) {
+    CHECK(lane < workers_.size()) << "Writer lane out of bounds!";
+    queue = &workers_[lane].lane;
+    if (controller_) {
+      // Parked workers write their lanes too, so they're all active.
+      controller_->FixWriters();
+    }
+  }
+  std::unique_lock<std::mutex> guard(lock_);
+  not_full_.wait(guard,
+                 [this, queue] { return queue->size() < queue_capacity_; });
+  queue->push_back(std::move(batch));
+  ++pending_;
+  if (lane != kAnyLane) {
+    has_task_.notify_all();
+  } else {
+    has_task_.notify_one();
+  }
+}
+
+void WriterPool::Sync() {
+  if (!workers_[0].thread.joinable()) {
+    Commit(&workers_[0]);
+  } else {
+    std::unique_lock<std::mutex> guard(lock_);
+    // Transactions are committed only once all of the batches are written,
+    // so that no worker opens a new transaction afterwards.
+    done_.wait(guard, [this] { return pending_ == 0; });
+    for (auto &worker : workers_) {
+      worker.commit_requested = true;
+      ++pending_;
+    }
+    has_task_.notify_all();
+    done_.wait(guard, [this] { return pending_ == 0; });
+  }
+  std::lock_guard<std::mutex> guard(failed_lock_);
+  CHECK(failed_batches_ == 0)
+      << failed_batches_
+      << " batch(es) couldn't be written to the destination database!";
+}
+
+void WriterPool::ExecuteMeasured(Worker *worker, WriteBatch batch) {
+  if (!controller_) {
+    Execute(worker, std::move(batch));
+    return;
+  }
+  const auto rows = batch.rows;
+  const auto bytes = batch.bytes;
+  const auto conflicts = worker->conflicts;
+  const auto start = std::chrono::steady_clock::now();
+  Execute(worker, std::move(batch));
+  const auto latency = std::chrono::steady_clock::now() - start;
+  if (controller_->Observe(rows, bytes, latency,
+                           worker->conflicts - conflicts)) {
+    // Parked workers may have to pick up batches from the shared queue.
+    std::lock_guard<std::mutex> guard(lock_);
+    has_task_.notify_all();
+  }
+}
+
+bool WriterPool::IsActive(const Worker &worker) const {
+  return !controller_ || worker.index < controller_->writers();
+}
+
+void WriterPool::Execute(Worker *worker, WriteBatch batch) {
+  if (UseTransactions() && !worker->in_transaction) {
+    if (!worker->client->Begin()) {
+      worker->transaction.push_back(std::move(batch));
+      Retry(worker, "Couldn't begin a transaction");
+      return;
+    }
+    worker->in_transaction = true;
+  }
+  worker->transaction_bytes += batch.bytes;
+  worker->transaction.push_back(std::move(batch));
+  std::string error;
+  if (!TryWrite(worker, worker->transaction.back(), &error)) {
+    Retry(worker, std::move(error));
+    return;
+  }
+  if (!worker->in_transaction) {
+    worker->transaction.clear();
+    worker->transaction_bytes = 0;
+    return;
+  }
+  if (worker->transaction.size() >= options_.transaction_batches ||
+      (options_.transaction_bytes > 0 &&
+       worker->transaction_bytes >= options_.transaction_bytes)) {
+    Commit(worker);
+  }
+}
+
+void WriterPool::Commit(Worker *worker) {
+  if (!worker->in_transaction) {
+    return;
+  }
+  if (!worker->client->Commit()) {
+    Retry(worker, "Couldn't commit the transaction");
+    return;
+  }
+  worker->in_transaction = false;
+  worker->transaction.clear();
+  worker->transaction_bytes = 0;
+}
+
+bool WriterPool::TryWrite(Worker *worker, const WriteBatch &batch,
+                          std::string *error) {
+  const auto &query = *batch.query;
+  try {
+    if (query.returns_ids) {
+      const auto ids = CreateNodesReturningIds(worker->client.get(), query,
+                                               batch.params.AsConstMap());
+      if (!ids) {
+        return false;
+      }
+      if (node_ids_callback_) {
+        node_ids_callback_(*ids);
+      }
+      return true;
+    }
+    if (!query.creates_relationships) {
+      return CreateNodes(worker->client.get(), query,
+                         batch.params.AsConstMap());
+    }
+    const auto created = CreateRelationships(worker->client.get(), query,
+                                             batch.params.AsConstMap());
+    if (!created) {
+      return false;
+    }
+    if (callback_) {
+      callback_(query, batch.rows, *created);
+    }
+    return true;
+  } catch (const std::exception &e) {
+    *error = e.what();
+    return false;
+  }
+}
+
+void WriterPool::Retry(Worker *worker, std::string error) {
+  for (size_t attempt = 1;
+       IsConflictError(error) && attempt <= options_.max_retries; ++attempt) {
+    if (worker->in_transaction) {
+      worker->client->Rollback();
+      worker->in_transaction = false;
+    }
+    ++worker->conflicts;
+    LOG(WARNING) << "Retrying a transaction of " << worker->transaction.size()
+                 << " batch(es) (attempt " << attempt << "/"
+                 << options_.max_retries << ")"
+                 << (error.empty() ? "" : ": " + error);
+    std::this_thread::sleep_for(GetRetryBackoff(attempt));
+
+    // The whole transaction is written again and committed right away.
+    error.clear();
+    if (UseTransactions()) {
+      if (!worker->client->Begin()) {
+        error = "Couldn't begin a transaction";
+        continue;
+      }
+      worker->in_transaction = true;
+    }
+    bool written = true;
+    for (const auto &batch : worker->transaction) {
+      if (!TryWrite(worker, batch, &error)) {
+        written = false;
+        break;
+      }
+    }
+    if (written && worker->in_transaction && !worker->client->Commit()) {
+      error = "Couldn't commit the transaction";
+      written = false;
+    }
+    worker->in_transaction = false;
+    if (written) {
+      worker->transaction.clear();
+      worker->transaction_bytes = 0;
+      return;
+    }
+  }
+
+  if (worker->in_transaction) {
+    worker->client->Rollback();
+    worker->in_transaction = false;
+  }
+  for (const auto &batch : worker->transaction) {
+    LOG(ERROR) << "Couldn't write a batch of " << batch.rows
+               << " row(s) using '" << batch.query->statement << "'"
+               << (error.empty() ? "" : ": " + error);
+  }
+  {
+    std::lock_guard<std::mutex> guard(failed_lock_);
+    failed_batches_ += worker->transaction.size();
+  }
+  worker->transaction.clear();
+  worker->transaction_bytes = 0;
+}
+
+void WriterPool::Run(Worker *worker) {
+  std::unique_lock<std::mutex> guard(lock_);
+  while (true) {
+    // Parked workers write only the batches of their own lane.
+    has_task_.wait(guard, [this, worker] {
+      return closed_ || worker->commit_requested || !worker->lane.empty() ||
+             (!queue_.empty() && IsActive(*worker));
+    });
+    if (worker->commit_requested) {
+      guard.unlock();
+      Commit(worker);
+      guard.lock();
+      worker->commit_requested = false;
+    } else if (!worker->lane.empty() ||
+               (!queue_.empty() && IsActive(*worker))) {
+      // Batches of the worker's own lane are written first.
+      auto *queue = worker->lane.empty() ? &queue_ : &worker->lane;
+      auto batch = std::move(queue->front());
+      queue->pop_front();
+      not_full_.notify_all();
+      guard.unlock();
+      ExecuteMeasured(worker, std::move(batch));
+      guard.lock();
+    } else {
+      // The pool is closed and there's nothing left for this worker to write.
+      return;
+    }
+    if (--pending_ == 0) {
+      done_.notify_all();
+    }
+  }
+}
+
+RelationshipRouter::RelationshipRouter(size_t lanes, size_t supernode_degree)
+    : lanes_(lanes), supernode_degree_(supernode_degree) {
+  CHECK(lanes_ > 0) << "Number of lanes should be a positive number!";
+  if (counts_degrees()) {
+    degrees_.resize(2 * kDegreeSlots, 0);
+  }
+}
+
+void RelationshipRouter::Count(const CompiledQuery &query,
+                               const mg::List &row) {
+  CHECK(!routing_)
+      << "Relationships should be counted before any of them is routed!";
+  if (!counts_degrees()) {
+    return;
+  }
+  CountDegree(HashNodeKey(query.label1, row, 0, query.id1_size));
+  CountDegree(HashNodeKey(query.label2, row, query.id1_size, query.id2_size));
+}
+
+std::pair<size_t, size_t> RelationshipRouter::GetDegreeSlots(size_t key) {
+  // The second row is indexed by a remixed hash, so that keys colliding in
+  // one row rarely collide in the other.
+  uint64_t mixed = key;
+  mixed = (mixed ^ (mixed >> 30)) * 0xbf58476d1ce4e5b9;
+  mixed = (mixed ^ (mixed >> 27)) * 0x94d049bb133111eb;
+  mixed ^= mixed >> 31;
+  return {key % kDegreeSlots, kDegreeSlots + mixed % kDegreeSlots};
+}
+
+void RelationshipRouter::CountDegree(size_t key) {
+  const auto [first, second] = GetDegreeSlots(key);
+  for (const auto slot : {first, second}) {
+    if (degrees_[slot] < UINT32_MAX) {
+      ++degrees_[slot];
+    }
+  }
+}
+
+size_t RelationshipRouter::GetDegree(size_t key) const {
+  if (degrees_.empty()) {
+    return 0;
+  }
+  const auto [first, second] = GetDegreeSlots(key);
+  return std::min(degrees_[first], degrees_[second]);
+}
+
+size_t RelationshipRouter::Route(const CompiledQuery &query,
+                                 const mg::List &row) {
+  CHECK(query.creates_relationships)
+      << "Only relationship queries can be routed!";
+  routing_ = true;
+  if (lanes_ == 1) {
+    return 0;
+  }
+  const auto key2 =
+      HashNodeKey(query.label2, row, query.id1_size, query.id2_size);
+  if (query.merge_end || !counts_degrees()) {
+    return key2 % lanes_;
+  }
+  const auto key1 = HashNodeKey(query.label1, row, 0, query.id1_size);
+  const auto degree1 = GetDegree(key1);
+  const auto degree2 = GetDegree(key2);
+  // The last lane is reserved for supernodes.
+  if (std::max(degree1, degree2) > supernode_degree_) {
+    return lanes_ - 1;
+  }
+  return (degree1 > degree2 ? key1 : key2) % (lanes_ - 1);
+}
+
+Batcher::Batcher(WriterPool *writer, const BatchOptions &options,
+                 BatchController *controller)
+    : writer_(writer),
+      controller_(controller),
+      batch_size_(options.batch_size),
+      estimate_bytes_(options.transaction_bytes > 0 || controller) {
+  CHECK(batch_size_ > 0) << "Batch size should be a positive number!";
+}
+
+Batcher::~Batcher() {
+  CHECK(buffers_.empty()) << "Batcher destroyed before being flushed!";
+}
+
+void Batcher::Add(const CompiledQuery *query, mg::List row, size_t lane) {
+  CHECK(row.size() == query->row_size)
+      << "Row size doesn't match the compiled query!";
+  const BufferKey key{query, lane};
+  auto it = buffers_.find(key);
+  if (it == buffers_.end()) {
+    const auto capacity = controller_ ? controller_->batch_size() : batch_size_;
+    it = buffers_.emplace(key, Buffer{mg::List(capacity), capacity, 0}).first;
+  }
+  auto &buffer = it->second;
+  if (estimate_bytes_) {
+    for (const auto &value : row) {
+      buffer.bytes += EstimateValueSize(value);
+    }
+  }
+  buffer.rows.Append(mg::Value(std::move(row)));
+  if (buffer.rows.size() >= buffer.capacity) {
+    Submit(key, std::move(buffer));
+    buffers_.erase(it);
+  }
+}
+
+void Batcher::Flush() {
+  for (auto &[key, buffer] : buffers_) {
+    Submit(key, std::move(buffer));
+  }
+  buffers_.clear();
+  writer_->Sync();
+}
+
+void Batcher::Submit(const BufferKey &key, Buffer buffer) {
+  const auto rows = buffer.rows.size();
+  writer_->Write(WriteBatch{key.first, MakeBatchParams(std::move(buffer.rows)),
+                            rows, buffer.bytes},
+                 key.second);
+}
@@ -0,0 +1,283 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "batch_controller.hpp"
+#include "memgraph_client.hpp"
+#include "memgraph_destination.hpp"
+#include "memory_monitor.hpp"
+
+struct BatchOptions {
+  /// Maximum number of rows sent by a single query.
+  size_t batch_size{1000};
+  /// Maximum number of batches written in a single explicit transaction. If
+  /// it's set to 1 and `transaction_bytes` is 0, batches are written in
+  /// auto-commit mode instead.
+  size_t transaction_batches{1};
+  /// Estimated size of batch values in bytes after which the transaction is
+  /// committed. If it's set to 0, there's no limit.
+  size_t transaction_bytes{0};
+  /// Maximum number of batches queued for writing while the previous batches
+  /// are still being written. If it's set to 0 and there's a single
+  /// connection, batches are written synchronously.
+  size_t window{0};
+  /// Maximum number of times a transaction is retried after it fails due to a
+  /// conflict with another transaction.
+  size_t max_retries{10};
+};
+
+/// Rows bound to the same compiled query, together with their estimated size
+/// in bytes.
+struct WriteBatch {
+  const CompiledQuery *query;
+  mg::Map params;
+  size_t rows;
+  size_t bytes;
+};
+
+/// Writes batches to the destination through a pool of connections. Each
+/// connection is used by its own thread, and all of them consume batches from
+/// a shared queue of limited size. Consecutive batches written by a connection
+/// are grouped into explicit transactions as described by `BatchOptions`. A
+/// transaction which fails due to a conflict with another transaction is
+/// rolled back and retried with all of its batches. Other failures aren't
+/// retried, since the transaction might have been committed regardless, and
+/// batches that couldn't be written are reported one by one. The `callback`
+/// is invoked with the number of rows and created/merged relationships of
+/// every written relationship batch, as returned by `CreateRelationships`,
+/// while the `node_ids_callback` is invoked with the keys and internal ids of
+/// nodes created by every batch of a query that returns ids. Both are invoked
+/// from the writing threads, and again if the batch is retried.
+///
+/// Besides the shared queue, each connection has its own lane. Batches
+/// written to the same lane are written by the same connection in the order
+/// they were submitted, so they never conflict with each other.
+class WriterPool {
+ public:
+  /// Lane value which lets any of the connections write the batch.
+  static constexpr size_t kAnyLane = static_cast<size_t>(-1);
+
+  using CreatedCallback =
+      std::function<void(const CompiledQuery &query, size_t rows,
+                         const std::vector<size_t> &created)>;
+  using NodeIdsCallback =
+      std::function<void(const std::vector<std::pair<int64_t, int64_t>> &ids)>;
+
+  WriterPool(std::vector<std::unique_ptr<MemgraphClient>> clients,
+             const BatchOptions &options, CreatedCallback callback = {},
+             NodeIdsCallback node_ids_callback = {});
+
+  WriterPool(const WriterPool &) = delete;
+  WriterPool(WriterPool &&) = delete;
+  WriterPool &operator=(const WriterPool &) = delete;
+  WriterPool &operator=(WriterPool &&) = delete;
+
+  ~WriterPool();
+
+  /// Returns the number of lanes, i.e. connections.
+  size_t lanes() const { return workers_.size(); }
+
+  /// Sets the `controller` which observes every written batch, and limits the
+  /// number of workers writing batches from the shared queue. Workers beyond
+  /// the limit are parked, but they still write batches of their own lanes,
+  /// so writing to a lane activates all of the workers until the controller
+  /// logs its next summary. It should be set before any batch is written.
+  void set_controller(BatchController *controller) { controller_ = controller; }
+
+  /// Sets the `monitor` of the destination memory usage, which pauses the
+  /// submission of batches while the usage is too high. Batches that were
+  /// already submitted are still written.
+  void set_memory_monitor(MemoryMonitor *monitor) { monitor_ = monitor; }
+
+  /// Submits the `batch` for writing to the given `lane`, or to the shared
+  /// queue if the lane is `kAnyLane`. It blocks while the queue is full, or
+  /// while the memory monitor pauses the submission.
+  void Write(WriteBatch batch, size_t lane = kAnyLane);
+
+  /// Blocks until all submitted batches are written and every connection
+  /// commits its open transaction. It aborts if any of the batches couldn't be
+  /// written.
+  void Sync();
+
+ private:
+  struct Worker {
+    size_t index{0};
+    std::unique_ptr<MemgraphClient> client;
+    std::thread thread;
+    bool commit_requested{false};
+    std::deque<WriteBatch> lane;
+
+    // Open transaction, or the batch being written in auto-commit mode:
+    bool in_transaction{false};
+    std::vector<WriteBatch> transaction;
+    size_t transaction_bytes{0};
+    /// Number of retried transactions.
+    size_t conflicts{0};
+  };
+
+  bool UseTransactions() const {
+    return options_.transaction_batches > 1 || options_.transaction_bytes > 0;
+  }
+
+  /// Writes the `batch` using the `worker` connection.
+  void Execute(Worker *worker, WriteBatch batch);
+
+  /// Same as `Execute`, but the batch is observed by the controller, if any.
+  void ExecuteMeasured(Worker *worker, WriteBatch batch);
+
+  /// Returns whether the `worker` writes batches from the shared queue.
+  bool IsActive(const Worker &worker) const;
+
+  /// Commits the open transaction of the `worker`.
+  void Commit(Worker *worker);
+
+  /// Writes the `batch` and sets the `error` on failure.
+  bool TryWrite(Worker *worker, const WriteBatch &batch, std::string *error);
+
+  /// Retries the open transaction of the `worker` after it failed with the
+  /// given `error`. Batches of the transaction are reported as failed if it
+  /// can't be retried.
+  void Retry(Worker *worker, std::string error);
+
+  void Run(Worker *worker);
+
+  BatchOptions options_;
+  CreatedCallback callback_;
+  NodeIdsCallback node_ids_callback_;
+  BatchController *controller_{nullptr};
+  MemoryMonitor *monitor_{nullptr};
+  std::vector<Worker> workers_;
+
+  // Queue shared by all workers, and the number of submitted tasks that
+  // aren't done yet. Lanes have the same capacity as the shared queue.
+  std::deque<WriteBatch> queue_;
+  size_t queue_capacity_;
+  size_t pending_{0};
+  bool closed_{false};
+  std::mutex lock_;
+  std::condition_variable has_task_;
+  std::condition_variable not_full_;
+  std::condition_variable done_;
+
+  std::mutex failed_lock_;
+  size_t failed_batches_{0};
+};
+
+/// Routes relationships to writer lanes by hashing the key of one of the nodes
+/// they connect, so that writes to that node are serialized by a single
+/// writer. The lane of a relationship depends only on its endpoints, so the
+/// relationships that follow the same node are always written by the same
+/// writer, in order. The other endpoint may still be written by any lane, e.g.
+/// a movie shared by actors whose relationships follow the actors, so
+/// conflicts on it are still possible and retried by the writer.
+///
+/// If there are more than two lanes and `supernode_degree` is positive, the
+/// degrees of all endpoints are counted by `Count` before the first
+/// relationship is routed. Each relationship then follows the endpoint with
+/// the higher degree, since that's the node most likely to be shared by
+/// concurrent transactions, and relationships of nodes whose degree exceeds
+/// `supernode_degree` are routed to the last lane, which is dedicated to
+/// supernodes so they can't stall the other lanes. Otherwise, relationships
+/// follow their end nodes, which are the referenced rows of foreign keys.
+/// Degrees are counted per instance, so it should be created per table.
+/// They're counted by a sketch of a fixed size, which never underestimates a
+/// degree, but may overestimate it when keys collide.
+///
+/// Relationships whose end nodes are merged, e.g. ghosts of nodes stored by
+/// another shard, are routed by the end node key only, so the same end node is
+/// never merged by concurrent transactions, which could create it twice.
+class RelationshipRouter {
+ public:
+  RelationshipRouter(size_t lanes, size_t supernode_degree);
+
+  /// Returns whether degrees of the endpoints should be counted before the
+  /// relationships are routed.
+  bool counts_degrees() const { return lanes_ > 2 && supernode_degree_ > 0; }
+
+  /// Counts the relationship bound to the `row` of the given relationship
+  /// `query` towards the degrees of its endpoints. All of the relationships
+  /// should be counted before the first one is routed.
+  void Count(const CompiledQuery &query, const mg::List &row);
+
+  /// Returns the lane for the relationship bound to the `row` of the given
+  /// relationship `query`.
+  size_t Route(const CompiledQuery &query, const mg::List &row);
+
+ private:
+  /// Number of counters in each row of the degree sketch.
+  static constexpr size_t kDegreeSlots = 1 << 20;
+
+  /// Returns the positions of the counters of the given key hash, one in each
+  /// row of the degree sketch.
+  static std::pair<size_t, size_t> GetDegreeSlots(size_t key);
+
+  /// Counts a relationship of the endpoint with the given key hash.
+  void CountDegree(size_t key);
+
+  /// Returns the counted degree of the endpoint with the given key hash.
+  size_t GetDegree(size_t key) const;
+
+  size_t lanes_;
+  size_t supernode_degree_;
+  /// Count-min sketch of relationships for each endpoint key hash, with two
+  /// rows of `kDegreeSlots` saturating counters. It's allocated only if
+  /// degrees are counted.
+  std::vector<uint32_t> degrees_;
+  bool routing_{false};
+};
+
+/// Buffers rows grouped by their compiled query and lane, and submits them to
+/// the `writer` in batches of at most `batch_size` rows. If the `controller`
+/// is set, its current batch size is used instead. `Flush` should be called
+/// once all rows are added, e.g. at the end of each table.
+class Batcher {
+ public:
+  Batcher(WriterPool *writer, const BatchOptions &options,
+          BatchController *controller = nullptr);
+
+  Batcher(const Batcher &) = delete;
+  Batcher(Batcher &&) = delete;
+  Batcher &operator=(const Batcher &) = delete;
+  Batcher &operator=(Batcher &&) = delete;
+
+  ~Batcher();
+
+  /// Adds a row bound to the given `query`, which is written to the given
+  /// writer `lane`. The row is moved into a batch which is pre-sized to
+  /// `batch_size` rows, and the batch is submitted as soon as it's full.
+  void Add(const CompiledQuery *query, mg::List row,
+           size_t lane = WriterPool::kAnyLane);
+
+  /// Submits all of the buffered rows and waits until the writer writes and
+  /// commits them.
+  void Flush();
+
+ private:
+  struct Buffer {
+    mg::List rows;
+    size_t capacity;
+    size_t bytes;
+  };
+
+  using BufferKey = std::pair<const CompiledQuery *, size_t>;
+
+  void Submit(const BufferKey &key, Buffer buffer);
+
+  WriterPool *writer_;
+  BatchController *controller_;
+  size_t batch_size_;
+  /// Batch sizes in bytes are estimated only if they're used to limit
+  /// transactions, or observed by the controller.
+  bool estimate_bytes_;
+  std::map<BufferKey, Buffer> buffers_;
+};
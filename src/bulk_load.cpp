@@ -0,0 +1,103 @@
+#include "bulk_load.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "memgraph_destination.hpp"
+
+namespace {
+
+const char *kAnalyticalMode = "IN_MEMORY_ANALYTICAL";
+const char *kOnDiskMode = "ON_DISK_TRANSACTIONAL";
+
+/// Sessions restored by the failure function, one for each destination.
+std::vector<BulkLoadSession *> active_sessions;
+
+}  // namespace
+
+BulkLoadSession::BulkLoadSession(MemgraphClient *client, Connect connect)
+    : client_(client),
+      connect_(std::move(connect)),
+      original_mode_(GetStorageMode(client_)),
+      on_disk_(original_mode_ == kOnDiskMode) {
+  active_sessions.push_back(this);
+  google::InstallFailureFunction(&BulkLoadSession::RestoreOnFailure);
+  if (!on_disk_ && original_mode_ != kAnalyticalMode) {
+    LOG(INFO) << "Switching the destination from " << original_mode_
+              << " to " << kAnalyticalMode << " storage mode";
+    CHECK(SetStorageMode(client_, kAnalyticalMode))
+        << "Couldn't switch the destination storage mode!";
+  }
+}
+
+BulkLoadSession::~BulkLoadSession() {
+  if (!finished_) {
+    Restore();
+  }
+  active_sessions.erase(
+      std::find(active_sessions.begin(), active_sessions.end(), this));
+  if (active_sessions.empty()) {
+    google::InstallFailureFunction(&abort);
+  }
+}
+
+void BulkLoadSession::BeginRelationships() {
+  if (on_disk_ && !importing_edges_) {
+    CHECK(SetEdgeImportMode(client_, true))
+        << "Couldn't activate the edge import mode!";
+    importing_edges_ = true;
+  }
+}
+
+void BulkLoadSession::EndRelationships() {
+  if (importing_edges_) {
+    CHECK(SetEdgeImportMode(client_, false))
+        << "Couldn't deactivate the edge import mode!";
+    importing_edges_ = false;
+  }
+}
+
+void BulkLoadSession::Finish() {
+  CHECK(!finished_) << "Bulk load session is already finished!";
+  EndRelationships();
+  if (GetStorageMode(client_) != original_mode_) {
+    LOG(INFO) << "Switching the destination back to " << original_mode_
+              << " storage mode";
+    CHECK(SetStorageMode(client_, original_mode_))
+        << "Couldn't switch the destination storage mode!";
+  }
+  LOG(INFO) << "Creating a snapshot of the destination";
+  CreateSnapshot(client_);
+  finished_ = true;
+}
+
+void BulkLoadSession::Restore() {
+  auto client = connect_();
+  if (!client) {
+    LOG(ERROR) << "Couldn't connect to the destination to restore its "
+               << original_mode_ << " storage mode!";
+    return;
+  }
+  if (importing_edges_ && !SetEdgeImportMode(client.get(), false)) {
+    LOG(ERROR) << "Couldn't deactivate the edge import mode!";
+  }
+  if (!on_disk_ && !SetStorageMode(client.get(), original_mode_)) {
+    LOG(ERROR) << "Couldn't restore the destination " << original_mode_
+               << " storage mode!";
+  }
+}
+
+void BulkLoadSession::RestoreOnFailure() {
+  // Restoring the mode can fail a check as well, so it's attempted only once.
+  static bool restoring = false;
+  if (!restoring) {
+    restoring = true;
+    for (auto *session : active_sessions) {
+      session->Restore();
+    }
+  }
+  abort();
+}
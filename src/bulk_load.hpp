@@ -0,0 +1,55 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "memgraph_client.hpp"
+
+/// Switches the destination database to a storage mode that's faster for
+/// loading large amounts of data, for the lifetime of the session. In-memory
+/// storage is switched to `IN_MEMORY_ANALYTICAL` mode, which doesn't keep
+/// deltas and write-ahead log. On-disk storage keeps its mode, and the edge
+/// import mode is activated while relationships are written instead.
+///
+/// `Finish` switches back to the original mode and creates a snapshot. If the
+/// session ends without finishing, or the program aborts on a failed check,
+/// the original mode is restored through a new connection from `connect`,
+/// because the session's connection could be in use. There can be a session
+/// for each of the destinations at the same time.
+class BulkLoadSession {
+ public:
+  using Connect = std::function<std::unique_ptr<MemgraphClient>()>;
+
+  BulkLoadSession(MemgraphClient *client, Connect connect);
+
+  BulkLoadSession(const BulkLoadSession &) = delete;
+  BulkLoadSession(BulkLoadSession &&) = delete;
+  BulkLoadSession &operator=(const BulkLoadSession &) = delete;
+  BulkLoadSession &operator=(BulkLoadSession &&) = delete;
+
+  ~BulkLoadSession();
+
+  /// Should be called before and after relationships are written, while there
+  /// are no other transactions in the destination database.
+  void BeginRelationships();
+  void EndRelationships();
+
+  /// Restores the original storage mode and creates a snapshot of the loaded
+  /// data.
+  void Finish();
+
+ private:
+  /// Restores the original storage mode through a new connection. It doesn't
+  /// abort on failure, so that it can be used by the failure function.
+  void Restore();
+
+  [[noreturn]] static void RestoreOnFailure();
+
+  MemgraphClient *client_;
+  Connect connect_;
+  std::string original_mode_;
+  bool on_disk_;
+  bool importing_edges_{false};
+  bool finished_{false};
+};
@@ -0,0 +1,65 @@
+#include "count_verifier.hpp"
+
+#include <map>
+#include <set>
+#include <string>
+
+#include <glog/logging.h>
+
+namespace {
+
+/// Logs and checks the `actual` count against the `expected` count of the
+/// named data. If the count is an `upper_bound`, the actual count may be
+/// lower.
+bool CheckCount(const std::string &name, size_t expected, size_t actual,
+                bool upper_bound) {
+  const bool matches = upper_bound ? actual <= expected : actual == expected;
+  if (matches) {
+    LOG(INFO) << "Verified " << actual << " " << name;
+  } else {
+    LOG(ERROR) << "Expected " << (upper_bound ? "at most " : "") << expected
+               << " " << name << ", but found " << actual;
+  }
+  return matches;
+}
+
+}  // namespace
+
+void CountVerifier::Verify(MemgraphClient *client) const {
+  size_t nodes = 0;
+  size_t relationships = 0;
+  bool merged = false;
+  std::map<std::string, size_t> labels;
+  std::map<std::string, size_t> edge_types;
+  std::set<std::string> merged_edge_types;
+  for (const auto &[query, rows] : expected_) {
+    if (query->creates_relationships) {
+      relationships += rows;
+      edge_types[query->edge_type] += rows;
+      if (query->use_merge) {
+        merged = true;
+        merged_edge_types.insert(query->edge_type);
+      }
+    } else {
+      nodes += rows;
+      for (const auto &label : query->labels) {
+        labels[label] += rows;
+      }
+    }
+  }
+
+  bool verified = CheckCount("nodes", nodes, CountNodes(client, ""), false);
+  for (const auto &[label, expected] : labels) {
+    verified &= CheckCount("nodes with label " + label, expected,
+                           CountNodes(client, label), false);
+  }
+  verified &= CheckCount("relationships", relationships,
+                         CountRelationships(client, ""), merged);
+  for (const auto &[edge_type, expected] : edge_types) {
+    verified &= CheckCount("relationships of type " + edge_type, expected,
+                           CountRelationships(client, edge_type),
+                           merged_edge_types.count(edge_type) > 0);
+  }
+  CHECK(verified) << "Numbers of migrated nodes and relationships don't match "
+                     "the source database!";
+}
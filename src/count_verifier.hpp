@@ -0,0 +1,28 @@
+#pragma once
+
+#include <unordered_map>
+
+#include "memgraph_client.hpp"
+#include "memgraph_destination.hpp"
+
+/// Counts rows submitted for each compiled query, and compares the expected
+/// numbers of nodes and relationships with the numbers found in the
+/// destination database once the migration is done. Nodes are compared per
+/// label and relationships per edge type, as well as in total. Relationships
+/// created by `MERGE` may already exist, so their expected number is only an
+/// upper bound. The destination is expected to be empty before the migration.
+/// Rows should be counted from a single thread.
+class CountVerifier {
+ public:
+  /// Counts `rows` rows bound to the given `query`.
+  void Expect(const CompiledQuery *query, size_t rows = 1) {
+    expected_[query] += rows;
+  }
+
+  /// Compares the expected numbers with the destination database. It aborts
+  /// if any of them doesn't match.
+  void Verify(MemgraphClient *client) const;
+
+ private:
+  std::unordered_map<const CompiledQuery *, size_t> expected_;
+};
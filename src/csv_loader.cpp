@@ -0,0 +1,144 @@
+#include "csv_loader.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+#include <glog/logging.h>
+
+CsvLoader::CsvLoader(MemgraphClient *destination, std::string directory,
+                     std::string server_directory, size_t max_rows)
+    : destination_(destination),
+      directory_(std::move(directory)),
+      server_directory_(std::move(server_directory)),
+      max_rows_(max_rows) {
+  CHECK(max_rows_ > 0) << "Number of rows per CSV file should be positive!";
+  std::filesystem::create_directories(directory_);
+  const auto statements_path =
+      (std::filesystem::path(directory_) / kStatementsFile).string();
+  statements_.open(statements_path);
+  CHECK(statements_) << "Couldn't open " << statements_path << "!";
+  const auto manifest_path =
+      (std::filesystem::path(directory_) / kManifestFile).string();
+  manifest_.open(manifest_path);
+  CHECK(manifest_) << "Couldn't open " << manifest_path << "!";
+  manifest_ << "file,rows,columns\n";
+}
+
+CsvLoader::~CsvLoader() {
+  CHECK(staged_.empty()) << "CSV loader destroyed before being flushed!";
+}
+
+void CsvLoader::Register(const CompiledQuery *query, const NodeShape &shape) {
+  std::string name;
+  for (const auto &label : shape.labels) {
+    name += (name.empty() ? "" : "_") + label;
+  }
+  Register(query, shape, name);
+}
+
+void CsvLoader::Register(const CompiledQuery *query,
+                         const RelationshipShape &shape) {
+  Register(query, shape, shape.edge_type);
+}
+
+void CsvLoader::Register(const CompiledQuery *query,
+                         std::variant<NodeShape, RelationshipShape> shape,
+                         const std::string &name) {
+  if (staged_.count(query) > 0) {
+    return;
+  }
+  // File names keep only the safe characters of label and edge type names,
+  // prefixed by a unique sequence number.
+  std::ostringstream file_name;
+  file_name << std::setfill('0') << std::setw(6) << next_file_ << "-";
+  for (auto c : name) {
+    file_name << (std::isalnum(static_cast<unsigned char>(c)) ? c : '_');
+  }
+  staged_.emplace(query,
+                  Staged{next_file_++, std::move(shape), file_name.str(), {}});
+}
+
+void CsvLoader::Add(const CompiledQuery *query, const mg::List &row) {
+  auto it = staged_.find(query);
+  CHECK(it != staged_.end()) << "Shape of the query isn't registered!";
+  auto &staged = it->second;
+  if (staged.files.empty() || staged.files.back()->rows() >= max_rows_) {
+    if (!staged.files.empty()) {
+      staged.files.back()->Close();
+    }
+    // Each file of the query is numbered by its position.
+    std::ostringstream file_name;
+    file_name << staged.name << "-" << std::setfill('0') << std::setw(6)
+              << staged.files.size() << ".csv";
+    staged.files.push_back(std::make_unique<CsvStagingFile>(
+        (std::filesystem::path(directory_) / file_name.str()).string(),
+        query->row_size));
+  }
+  staged.files.back()->Write(row);
+}
+
+void CsvLoader::Record(const CsvStagingFile &file,
+                       const std::string &statement) {
+  statements_ << statement << "\n";
+  statements_.flush();
+  CHECK(statements_) << "Couldn't write " << kStatementsFile << "!";
+  manifest_ << std::filesystem::path(file.path()).filename().string() << ","
+            << file.rows() << ",";
+  const auto &types = file.column_types();
+  for (size_t i = 0; i < types.size(); ++i) {
+    manifest_ << (i > 0 ? ";" : "") << GetCsvColumnTypeName(types[i]);
+  }
+  manifest_ << "\n";
+  manifest_.flush();
+  CHECK(manifest_) << "Couldn't write " << kManifestFile << "!";
+}
+
+void CsvLoader::Flush() {
+  std::vector<Staged *> queries;
+  for (auto &[query, staged] : staged_) {
+    if (!staged.files.empty()) {
+      staged.files.back()->Close();
+      queries.push_back(&staged);
+    }
+  }
+  std::sort(queries.begin(), queries.end(), [](const auto *a, const auto *b) {
+    return a->order < b->order;
+  });
+  for (const auto *staged : queries) {
+    for (const auto &file : staged->files) {
+      const auto server_path =
+          (std::filesystem::path(server_directory_) /
+           std::filesystem::path(file->path()).filename())
+              .string();
+      const auto statement =
+          std::holds_alternative<NodeShape>(staged->shape)
+              ? GetLoadCsvNodesStatement(std::get<NodeShape>(staged->shape),
+                                         file->column_types(), server_path)
+              : GetLoadCsvRelationshipsStatement(
+                    std::get<RelationshipShape>(staged->shape),
+                    file->column_types(), server_path);
+      // The statement is recorded first, so that a failed load can be
+      // resumed from it.
+      Record(*file, statement);
+      LOG(INFO) << "Loading " << file->rows() << " rows from " << server_path;
+      const auto loaded = LoadCsv(destination_, statement);
+      // Rows whose endpoints are missing don't match anything, while merged
+      // relationships may match more than one relationship.
+      const auto *shape = std::get_if<RelationshipShape>(&staged->shape);
+      if (shape && shape->use_merge) {
+        CHECK(loaded >= file->rows())
+            << "Couldn't find the endpoints of relationships from "
+            << server_path << "!";
+      } else {
+        CHECK(loaded == file->rows())
+            << "Expected to load " << file->rows() << " rows from "
+            << server_path << ", but " << loaded << " were loaded!";
+      }
+    }
+  }
+  staged_.clear();
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "csv_staging.hpp"
+#include "memgraph_client.hpp"
+#include "memgraph_destination.hpp"
+
+/// Stages rows of compiled queries in CSV files, and loads each file into the
+/// destination database by a single LOAD CSV query. Rows of a query are split
+/// into files of at most `max_rows` rows, so that each transaction stays
+/// bounded. Files are written to the `directory`, which the destination
+/// database sees as the `server_directory`, and they're kept after being
+/// loaded.
+///
+/// Each LOAD CSV query is appended to `load.cypherl` in the same directory
+/// before it's executed, and each file is listed in `manifest.csv` with its
+/// number of rows and column types, so the files can be loaded again later,
+/// e.g. by replaying `load.cypherl` into another instance once its indices and
+/// constraints are created.
+class CsvLoader {
+ public:
+  static constexpr const char *kStatementsFile = "load.cypherl";
+  static constexpr const char *kManifestFile = "manifest.csv";
+
+  CsvLoader(MemgraphClient *destination, std::string directory,
+            std::string server_directory, size_t max_rows);
+
+  CsvLoader(const CsvLoader &) = delete;
+  CsvLoader(CsvLoader &&) = delete;
+  CsvLoader &operator=(const CsvLoader &) = delete;
+  CsvLoader &operator=(CsvLoader &&) = delete;
+
+  ~CsvLoader();
+
+  /// Registers the `shape` the `query` was compiled for. Rows of the query can
+  /// be added only once its shape is registered.
+  void Register(const CompiledQuery *query, const NodeShape &shape);
+
+  void Register(const CompiledQuery *query, const RelationshipShape &shape);
+
+  /// Stages a `row` bound to the given `query`.
+  void Add(const CompiledQuery *query, const mg::List &row);
+
+  /// Loads all of the staged files, in the order their queries were
+  /// registered.
+  void Flush();
+
+ private:
+  struct Staged {
+    size_t order;
+    std::variant<NodeShape, RelationshipShape> shape;
+    std::string name;
+    std::vector<std::unique_ptr<CsvStagingFile>> files;
+  };
+
+  void Register(const CompiledQuery *query,
+                std::variant<NodeShape, RelationshipShape> shape,
+                const std::string &name);
+
+  /// Records the LOAD CSV `statement` of the staged `file` in the statements
+  /// file and the manifest.
+  void Record(const CsvStagingFile &file, const std::string &statement);
+
+  MemgraphClient *destination_;
+  std::string directory_;
+  std::string server_directory_;
+  size_t max_rows_;
+  std::ofstream statements_;
+  std::ofstream manifest_;
+  size_t next_file_{0};
+  std::map<const CompiledQuery *, Staged> staged_;
+};
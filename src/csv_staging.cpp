@@ -0,0 +1,128 @@
+#include "csv_staging.hpp"
+
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+#include <glog/logging.h>
+
+namespace {
+
+/// Writes the `text` as a CSV field, quoting it only if needed.
+void WriteField(std::ostream *stream, const std::string_view &text) {
+  if (text.find_first_of(",\"\r\n") == std::string_view::npos) {
+    *stream << text;
+    return;
+  }
+  *stream << '"';
+  for (auto c : text) {
+    if (c == '"') {
+      *stream << '"';
+    }
+    *stream << c;
+  }
+  *stream << '"';
+}
+
+/// Returns the column type of the `value`.
+CsvColumnType GetColumnType(const mg::ConstValue &value) {
+  switch (value.type()) {
+    case mg::Value::Type::Null:
+      return CsvColumnType::kNull;
+    case mg::Value::Type::Bool:
+      return CsvColumnType::kBool;
+    case mg::Value::Type::Int:
+      return CsvColumnType::kInt;
+    case mg::Value::Type::Double:
+      return CsvColumnType::kDouble;
+    case mg::Value::Type::String:
+      return CsvColumnType::kString;
+    default:
+      LOG(FATAL) << "Value of this type can't be staged in a CSV file! Please "
+                    "migrate the database without CSV staging.";
+  }
+}
+
+}  // namespace
+
+const char *GetCsvColumnTypeName(CsvColumnType type) {
+  switch (type) {
+    case CsvColumnType::kNull:
+      return "null";
+    case CsvColumnType::kBool:
+      return "bool";
+    case CsvColumnType::kInt:
+      return "int";
+    case CsvColumnType::kDouble:
+      return "double";
+    case CsvColumnType::kString:
+      return "string";
+  }
+  LOG(FATAL) << "Unexpected CSV column type!";
+}
+
+CsvStagingFile::CsvStagingFile(std::string path, size_t columns)
+    : path_(std::move(path)),
+      file_(path_),
+      column_types_(columns, CsvColumnType::kNull) {
+  CHECK(file_) << "Couldn't open the CSV staging file " << path_ << "!";
+  for (size_t i = 0; i < columns; ++i) {
+    file_ << (i > 0 ? "," : "") << "c" << i;
+  }
+  file_ << "\n";
+}
+
+void CsvStagingFile::Write(const mg::List &row) {
+  CHECK(row.size() == column_types_.size())
+      << "Row size doesn't match the CSV staging file!";
+  for (size_t i = 0; i < row.size(); ++i) {
+    const auto value = row[i];
+    const auto type = GetColumnType(value);
+    auto &column_type = column_types_[i];
+    if (column_type == CsvColumnType::kNull ||
+        (column_type == CsvColumnType::kInt &&
+         type == CsvColumnType::kDouble)) {
+      column_type = type;
+    }
+    CHECK(type == CsvColumnType::kNull || type == column_type ||
+          (type == CsvColumnType::kInt &&
+           column_type == CsvColumnType::kDouble))
+        << "Values of different types can't be staged in the same CSV "
+           "column!";
+
+    if (i > 0) {
+      file_ << ",";
+    }
+    switch (type) {
+      case CsvColumnType::kNull:
+        break;
+      case CsvColumnType::kBool:
+        file_ << (value.ValueBool() ? "true" : "false");
+        break;
+      case CsvColumnType::kInt:
+        file_ << value.ValueInt();
+        break;
+      case CsvColumnType::kDouble: {
+        std::ostringstream number;
+        number << std::setprecision(std::numeric_limits<double>::max_digits10)
+               << value.ValueDouble();
+        file_ << number.str();
+        break;
+      }
+      case CsvColumnType::kString: {
+        std::string text("'");
+        text.append(value.ValueString());
+        WriteField(&file_, text);
+        break;
+      }
+    }
+  }
+  file_ << "\n";
+  CHECK(file_) << "Couldn't write the CSV staging file " << path_ << "!";
+  ++rows_;
+}
+
+void CsvStagingFile::Close() {
+  file_.close();
+  CHECK(file_) << "Couldn't write the CSV staging file " << path_ << "!";
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <mgclient-value.hpp>
+
+/// Type of values in a column of a staged CSV file. All values of a column
+/// have the same type, except for nulls, and the type stays `kNull` while the
+/// column holds only nulls.
+enum class CsvColumnType { kNull, kBool, kInt, kDouble, kString };
+
+/// Returns the name of the column `type`, e.g. `int`, as listed in manifests
+/// of staged files.
+const char *GetCsvColumnTypeName(CsvColumnType type);
+
+/// CSV file with staged rows, which can be loaded into the destination
+/// database by LOAD CSV. Columns are named `c0`, `c1`, etc. All values are
+/// loaded as strings, so each value is written in a way that lets the load
+/// query restore its type: nulls are written as empty cells, and strings are
+/// prefixed with a single `'` character, so that empty strings aren't confused
+/// with nulls. Integers are promoted to doubles if a column holds both.
+class CsvStagingFile {
+ public:
+  /// Creates a file at the given `path` with `columns` columns. The file is
+  /// overwritten if it already exists.
+  CsvStagingFile(std::string path, size_t columns);
+
+  CsvStagingFile(const CsvStagingFile &) = delete;
+  CsvStagingFile(CsvStagingFile &&) = delete;
+  CsvStagingFile &operator=(const CsvStagingFile &) = delete;
+  CsvStagingFile &operator=(CsvStagingFile &&) = delete;
+
+  /// Writes a single `row`. It aborts if a value can't be staged, e.g. lists
+  /// and maps, or if its type doesn't match the rest of the column.
+  void Write(const mg::List &row);
+
+  /// Closes the file, so that it can be loaded.
+  void Close();
+
+  const std::string &path() const { return path_; }
+
+  const std::vector<CsvColumnType> &column_types() const {
+    return column_types_;
+  }
+
+  size_t rows() const { return rows_; }
+
+ private:
+  std::string path_;
+  std::ofstream file_;
+  std::vector<CsvColumnType> column_types_;
+  size_t rows_{0};
+};
@@ -0,0 +1,325 @@
+#include "cypherl_destination.hpp"
+
+#include <cctype>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+#include <glog/logging.h>
+
+#include "utils/algorithm.hpp"
+
+namespace {
+
+/// Writes the `text` as a single-quoted string literal. Line breaks are
+/// escaped, so that each statement stays on a single line.
+void WriteStringLiteral(std::ostream *stream, const std::string_view &text) {
+  *stream << "'";
+  for (auto c : text) {
+    switch (c) {
+      case '\\':
+        *stream << "\\\\";
+        break;
+      case '\'':
+        *stream << "\\'";
+        break;
+      case '\n':
+        *stream << "\\n";
+        break;
+      case '\r':
+        *stream << "\\r";
+        break;
+      case '\t':
+        *stream << "\\t";
+        break;
+      default:
+        *stream << c;
+    }
+  }
+  *stream << "'";
+}
+
+/// Number of nanoseconds in a day.
+const int64_t kDayNanoseconds = 86400LL * 1000000000LL;
+
+/// Writes the date the given number of `days` after the Unix epoch as
+/// YYYY-MM-DD, following the proleptic Gregorian calendar.
+void WriteDate(std::ostream *stream, int64_t days) {
+  // Days are counted from 0000-03-01 in 400-year eras, so that leap days end
+  // each year.
+  const int64_t shifted = days + 719468;
+  const int64_t era = (shifted >= 0 ? shifted : shifted - 146096) / 146097;
+  const int64_t day_of_era = shifted - era * 146097;
+  const int64_t year_of_era =
+      (day_of_era - day_of_era / 1460 + day_of_era / 36524 -
+       day_of_era / 146096) /
+      365;
+  const int64_t day_of_year =
+      day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+  const int64_t shifted_month = (5 * day_of_year + 2) / 153;
+  const int64_t day = day_of_year - (153 * shifted_month + 2) / 5 + 1;
+  const int64_t month = shifted_month < 10 ? shifted_month + 3
+                                           : shifted_month - 9;
+  const int64_t year = year_of_era + era * 400 + (month <= 2 ? 1 : 0);
+  *stream << std::setfill('0') << std::setw(4) << year << "-" << std::setw(2)
+          << month << "-" << std::setw(2) << day << std::setfill(' ');
+}
+
+/// Writes the time the given number of `nanoseconds` after midnight as
+/// hh:mm:ss.ffffff. Memgraph keeps temporal values in microseconds, so the
+/// remaining nanoseconds are dropped.
+void WriteTime(std::ostream *stream, int64_t nanoseconds) {
+  const int64_t microseconds = nanoseconds / 1000;
+  const int64_t seconds = microseconds / 1000000;
+  *stream << std::setfill('0') << std::setw(2) << seconds / 3600 << ":"
+          << std::setw(2) << seconds / 60 % 60 << ":" << std::setw(2)
+          << seconds % 60 << "." << std::setw(6) << microseconds % 1000000
+          << std::setfill(' ');
+}
+
+/// Writes the `value` as a Cypher literal.
+void WriteLiteral(std::ostream *stream, const mg::ConstValue &value) {
+  switch (value.type()) {
+    case mg::Value::Type::Null:
+      *stream << "null";
+      break;
+    case mg::Value::Type::Bool:
+      *stream << (value.ValueBool() ? "true" : "false");
+      break;
+    case mg::Value::Type::Int:
+      *stream << value.ValueInt();
+      break;
+    case mg::Value::Type::Double: {
+      const auto number = value.ValueDouble();
+      if (std::isnan(number)) {
+        *stream << "toFloat('NaN')";
+      } else if (std::isinf(number)) {
+        *stream << (number > 0 ? "toFloat('Inf')" : "toFloat('-Inf')");
+      } else {
+        // Doubles are written with a decimal point, so they aren't read back
+        // as integers.
+        std::ostringstream number_stream;
+        number_stream << std::setprecision(
+                             std::numeric_limits<double>::max_digits10)
+                      << number;
+        auto text = number_stream.str();
+        if (text.find_first_of(".e") == std::string::npos) {
+          text += ".0";
+        }
+        *stream << text;
+      }
+      break;
+    }
+    case mg::Value::Type::String:
+      WriteStringLiteral(stream, value.ValueString());
+      break;
+    case mg::Value::Type::List:
+      *stream << "[";
+      utils::PrintIterable(
+          *stream, value.ValueList(), ", ",
+          [](auto &os, const auto &item) { WriteLiteral(&os, item); });
+      *stream << "]";
+      break;
+    case mg::Value::Type::Map:
+      *stream << "{";
+      utils::PrintIterable(*stream, value.ValueMap(), ", ",
+                           [](auto &os, const auto &item) {
+                             // Keys are escaped in the same way as names.
+                             os << "`";
+                             for (auto c : item.first) {
+                               os << c;
+                               if (c == '`') {
+                                 os << c;
+                               }
+                             }
+                             os << "`: ";
+                             WriteLiteral(&os, item.second);
+                           });
+      *stream << "}";
+      break;
+    case mg::Value::Type::Date:
+      *stream << "date('";
+      WriteDate(stream, value.ValueDate().days());
+      *stream << "')";
+      break;
+    case mg::Value::Type::LocalTime:
+      *stream << "localTime('";
+      WriteTime(stream, value.ValueLocalTime().nanoseconds());
+      *stream << "')";
+      break;
+    case mg::Value::Type::LocalDateTime: {
+      const auto local_date_time = value.ValueLocalDateTime();
+      // Seconds before the epoch are negative, while nanoseconds never are.
+      auto days = local_date_time.seconds() / 86400;
+      auto nanoseconds = (local_date_time.seconds() % 86400) * 1000000000 +
+                         local_date_time.nanoseconds();
+      if (nanoseconds < 0) {
+        --days;
+        nanoseconds += kDayNanoseconds;
+      }
+      *stream << "localDateTime('";
+      WriteDate(stream, days);
+      *stream << "T";
+      WriteTime(stream, nanoseconds);
+      *stream << "')";
+      break;
+    }
+    case mg::Value::Type::Duration: {
+      const auto duration = value.ValueDuration();
+      // Memgraph durations don't have months, since their length varies.
+      CHECK(duration.months() == 0)
+          << "Durations with months can't be written as literals!";
+      *stream << "duration({day: " << duration.days()
+              << ", second: " << duration.seconds()
+              << ", microsecond: " << duration.nanoseconds() / 1000 << "})";
+      break;
+    }
+    default:
+      LOG(FATAL) << "Value of this type can't be written as a literal!";
+  }
+}
+
+}  // namespace
+
+std::string InlineParams(const std::string &statement,
+                         const mg::ConstMap &params) {
+  std::ostringstream stream;
+  char quote = 0;
+  for (size_t i = 0; i < statement.size(); ++i) {
+    const auto c = statement[i];
+    if (quote != 0) {
+      if (c == quote) {
+        quote = 0;
+      }
+      stream << c;
+      continue;
+    }
+    if (c == '`' || c == '\'' || c == '"') {
+      quote = c;
+      stream << c;
+      continue;
+    }
+    if (c != '$') {
+      stream << c;
+      continue;
+    }
+    size_t end = i + 1;
+    while (end < statement.size() &&
+           (std::isalnum(static_cast<unsigned char>(statement[end])) ||
+            statement[end] == '_')) {
+      ++end;
+    }
+    const std::string_view name(statement.data() + i + 1, end - i - 1);
+    auto it = params.find(name);
+    CHECK(it != params.end())
+        << "Parameter '" << name << "' is missing from the statement params!";
+    WriteLiteral(&stream, (*it).second);
+    i = end - 1;
+  }
+  return stream.str();
+}
+
+CypherlDump::CypherlDump(std::filesystem::path directory,
+                         size_t max_statements)
+    : directory_(std::move(directory)), max_statements_(max_statements) {
+  CHECK(max_statements_ > 0)
+      << "Number of statements per file should be a positive number!";
+  std::filesystem::create_directories(directory_);
+}
+
+size_t CypherlDump::EnterStage(bool schema) {
+  std::lock_guard<std::mutex> guard(lock_);
+  if (schema != schema_stage_) {
+    ++stage_;
+    schema_stage_ = schema;
+  }
+  return stage_;
+}
+
+size_t CypherlDump::NextClientId() {
+  std::lock_guard<std::mutex> guard(lock_);
+  return next_client_id_++;
+}
+
+CypherlFileClient::CypherlFileClient(std::shared_ptr<CypherlDump> dump)
+    : dump_(std::move(dump)), client_id_(dump_->NextClientId()) {}
+
+CypherlFileClient::~CypherlFileClient() {
+  CHECK(!in_transaction_) << "Transaction wasn't committed before the dump "
+                             "file was closed!";
+}
+
+bool CypherlFileClient::Execute(const std::string &statement) {
+  // Schema statements aren't part of explicit transactions.
+  Write(dump_->EnterStage(true), {statement});
+  return true;
+}
+
+bool CypherlFileClient::Execute(const std::string &statement,
+                                const mg::ConstMap &params) {
+  auto inlined = InlineParams(statement, params);
+  if (in_transaction_) {
+    transaction_.push_back(std::move(inlined));
+  } else {
+    Write(dump_->EnterStage(false), {std::move(inlined)});
+  }
+  return true;
+}
+
+bool CypherlFileClient::Begin() {
+  if (in_transaction_) {
+    return false;
+  }
+  in_transaction_ = true;
+  return true;
+}
+
+bool CypherlFileClient::Commit() {
+  if (!in_transaction_) {
+    return false;
+  }
+  if (!transaction_.empty()) {
+    Write(dump_->EnterStage(false), transaction_);
+  }
+  in_transaction_ = false;
+  transaction_.clear();
+  return true;
+}
+
+bool CypherlFileClient::Rollback() {
+  if (!in_transaction_) {
+    return false;
+  }
+  in_transaction_ = false;
+  transaction_.clear();
+  return true;
+}
+
+void CypherlFileClient::Write(size_t stage,
+                              const std::vector<std::string> &statements) {
+  if (!file_.is_open() || stage != file_stage_ ||
+      file_statements_ >= dump_->max_statements()) {
+    // Parts are numbered from 0 within each stage.
+    const bool rotated = file_.is_open() && stage == file_stage_;
+    if (file_.is_open()) {
+      file_.close();
+      CHECK(file_) << "Couldn't write a dump file!";
+    }
+    file_part_ = rotated ? file_part_ + 1 : 0;
+    file_stage_ = stage;
+    file_statements_ = 0;
+    std::ostringstream name;
+    name << std::setfill('0') << std::setw(6) << stage << "-"
+         << std::setw(4) << client_id_ << "-" << std::setw(6) << file_part_
+         << ".cypherl";
+    const auto path = dump_->directory() / name.str();
+    file_.open(path);
+    CHECK(file_) << "Couldn't open the dump file " << path << "!";
+  }
+  for (const auto &statement : statements) {
+    file_ << statement << "\n";
+  }
+  file_statements_ += statements.size();
+  CHECK(file_) << "Couldn't write a dump file!";
+}
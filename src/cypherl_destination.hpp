@@ -0,0 +1,103 @@
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "memgraph_client.hpp"
+
+/// Returns the `statement` with each parameter replaced by the literal of its
+/// value from the `params`. Parameters aren't replaced inside of quoted names
+/// and strings. Strings are single-quoted with line breaks escaped, so that
+/// the statement stays on a single line.
+std::string InlineParams(const std::string &statement,
+                         const mg::ConstMap &params);
+
+/// Output directory shared by clients that write statements to `.cypherl`
+/// files instead of executing them. Files are named
+/// `<stage>-<client>-<part>.cypherl`, where the stage changes each time the
+/// clients switch between data statements (statements with parameters) and
+/// schema statements. A dump can be replayed stage by stage, where all of the
+/// files of a single stage can be replayed in parallel.
+class CypherlDump {
+ public:
+  /// Creates a dump in the given `directory`, where each file holds at most
+  /// `max_statements` statements. Files are rotated only between
+  /// transactions.
+  CypherlDump(std::filesystem::path directory, size_t max_statements);
+
+  CypherlDump(const CypherlDump &) = delete;
+  CypherlDump(CypherlDump &&) = delete;
+  CypherlDump &operator=(const CypherlDump &) = delete;
+  CypherlDump &operator=(CypherlDump &&) = delete;
+
+  /// Returns the stage of the next statement, given whether it's a
+  /// `schema` statement.
+  size_t EnterStage(bool schema);
+
+  /// Returns a unique id of a new client.
+  size_t NextClientId();
+
+  const std::filesystem::path &directory() const { return directory_; }
+
+  size_t max_statements() const { return max_statements_; }
+
+ private:
+  std::filesystem::path directory_;
+  size_t max_statements_;
+
+  std::mutex lock_;
+  size_t stage_{0};
+  bool schema_stage_{false};
+  size_t next_client_id_{0};
+};
+
+/// A concrete implementation of MemgraphClient interface, which writes each
+/// executed statement as a single line of a `.cypherl` file in the `dump`, with
+/// parameters inlined as literals. Statements of an explicit transaction are
+/// kept in memory and written only once it's committed, so each transaction
+/// ends up in a single file. Statements never return any data.
+class CypherlFileClient : public MemgraphClient {
+ public:
+  explicit CypherlFileClient(std::shared_ptr<CypherlDump> dump);
+
+  CypherlFileClient(const CypherlFileClient &) = delete;
+  CypherlFileClient(CypherlFileClient &&) = delete;
+  CypherlFileClient &operator=(const CypherlFileClient &) = delete;
+  CypherlFileClient &operator=(CypherlFileClient &&) = delete;
+  ~CypherlFileClient() override;
+
+  bool Execute(const std::string &statement) override;
+
+  bool Execute(const std::string &statement,
+               const mg::ConstMap &params) override;
+
+  std::optional<std::vector<mg::Value>> FetchOne() override {
+    return std::nullopt;
+  }
+
+  bool Begin() override;
+
+  bool Commit() override;
+
+  bool Rollback() override;
+
+ private:
+  /// Writes the `statements` to the file of the given stage, after rotating
+  /// the current file if needed.
+  void Write(size_t stage, const std::vector<std::string> &statements);
+
+  std::shared_ptr<CypherlDump> dump_;
+  size_t client_id_;
+
+  std::ofstream file_;
+  size_t file_stage_{0};
+  size_t file_part_{0};
+  size_t file_statements_{0};
+
+  bool in_transaction_{false};
+  std::vector<std::string> transaction_;
+};
@@ -1,10 +1,25 @@
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <unordered_map>
 
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include "batch_writer.hpp"
+#include "bulk_load.hpp"
+#include "count_verifier.hpp"
+#include "csv_loader.hpp"
+#include "cypherl_destination.hpp"
 #include "memgraph_client.hpp"
 #include "memgraph_destination.hpp"
+#include "memory_monitor.hpp"
+#include "row_binding.hpp"
+#include "schema_plan.hpp"
+#include "shard_map.hpp"
 #include "source/memgraph.hpp"
 #include "source/mysql.hpp"
 #include "source/postgresql.hpp"
@@ -30,6 +45,19 @@ DEFINE_bool(source_use_ssl, false,
             "Use SSL when connecting to the source database.");
 DEFINE_string(source_database, "",
               "Database name. Applicable to PostgreSQL source.");
+DEFINE_int64(source_page_size, 0,
+             "Number of consecutive internal ids read by a single query from "
+             "the Memgraph source. Each page is read by its own transaction "
+             "and read again if it fails. Internal ids aren't indexed, so "
+             "each page scans the whole graph, and the total cost grows with "
+             "the square of the graph size divided by the page size. Use it "
+             "only with pages large enough to keep the number of pages low. "
+             "If it's set to 0, all nodes and relationships are read by a "
+             "single query each.");
+DEFINE_int32(source_connections, 1,
+             "Number of connections that read disjoint internal id ranges of "
+             "the Memgraph source concurrently. Each id range scans the whole "
+             "graph.");
 
 DEFINE_string(destination_host, "127.0.0.1",
               "Server address of the destination database. It can be a DNS "
@@ -42,6 +70,155 @@ DEFINE_string(destination_password, "",
               "Password for the destination database.");
 DEFINE_bool(destination_use_ssl, false,
             "Use SSL when connecting to the destination database.");
+DEFINE_string(destinations, "",
+              "Comma-separated list of destination endpoints given as "
+              "host:port, which are used instead of --destination_host and "
+              "--destination_port. The source is read only once, and the "
+              "same data is written to each of the destinations, using the "
+              "same credentials. Each destination has its own queue of "
+              "--destination_window batches, so a slow destination stalls "
+              "the others only once its queue is full.");
+DEFINE_bool(shard_destinations, false,
+            "Split the graph across --destinations instead of writing all of "
+            "the data to each of them. Each node is written to a single "
+            "destination (shard), chosen by --shard_labels or by a hash of "
+            "its key, and each relationship is written to the shard of its "
+            "start node.");
+DEFINE_string(shard_labels, "",
+              "Comma-separated label=shard pairs, which assign all nodes with "
+              "the label to the shard with the given zero-based position in "
+              "--destinations when --shard_destinations is set. Other nodes "
+              "are assigned by a hash of their key.");
+DEFINE_string(cross_shard_relationships, "ghost",
+              "What to do with relationships whose endpoints are in different "
+              "shards. 'ghost' writes them to the shard of the start node, "
+              "with a ghost end node that holds only the key of the node, "
+              "while 'skip' doesn't write them.");
+
+DEFINE_string(destination_cypherl_directory, "",
+              "If set, the destination database isn't used. Instead, "
+              "statements are written to .cypherl files in the given "
+              "directory, with parameters inlined. Files are prefixed by a "
+              "stage number, and files of the same stage can be replayed in "
+              "parallel once all of the previous stages are replayed.");
+DEFINE_int32(destination_cypherl_statements, 1000,
+             "Maximum number of statements written to a single .cypherl "
+             "file before it's rotated.");
+
+DEFINE_string(csv_staging_directory, "",
+              "If set, rows of SQL tables are staged in CSV files in the given "
+              "directory, and loaded into the destination database by LOAD "
+              "CSV, one query per file. Files are kept after the migration, "
+              "together with load.cypherl, which holds the executed LOAD CSV "
+              "queries, and manifest.csv, which lists the files.");
+DEFINE_int32(csv_staging_rows, 100000,
+             "Maximum number of rows staged in a single CSV file. Each file is "
+             "loaded in its own transaction.");
+DEFINE_string(csv_server_directory, "",
+              "Path of the CSV staging directory as seen by the destination "
+              "database, if it differs from --csv_staging_directory.");
+
+DEFINE_bool(bulk_load, false,
+            "Switch the destination database to the IN_MEMORY_ANALYTICAL "
+            "storage mode while the data is migrated, or activate the edge "
+            "import mode while relationships are migrated to the on-disk "
+            "storage. Once the migration is done, the original mode is "
+            "restored and a snapshot is created. The original mode is also "
+            "restored if the migration fails. Failed transactions aren't "
+            "retried in this mode, because their writes aren't rolled back, "
+            "so any failed batch aborts the migration.");
+
+DEFINE_int32(batch_size, 1000,
+             "Maximum number of nodes or relationships that are created in "
+             "the destination database by a single query.");
+DEFINE_int32(transaction_batches, 1,
+             "Maximum number of batches written to the destination database "
+             "in a single transaction. If set to 1 and --transaction_bytes is "
+             "0, each batch is written in its own auto-commit transaction. "
+             "Open transaction is always committed at the end of each table.");
+DEFINE_int64(transaction_bytes, 0,
+             "Estimated size of batch values in bytes after which the "
+             "transaction in the destination database is committed. If set to "
+             "0, there's no limit.");
+DEFINE_int32(destination_window, 4,
+             "Maximum number of batches queued for the destination connections "
+             "while the previous batch is still being written. Batches are "
+             "written by a dedicated thread, so reading the source overlaps "
+             "with writing to the destination. If set to 0, batches are "
+             "written synchronously.");
+DEFINE_int32(destination_connections, 1,
+             "Number of connections used to write batches to the destination "
+             "database concurrently. Each connection writes its own "
+             "transactions, so batches of the same table may be committed in "
+             "a different order.");
+DEFINE_bool(memgraph_id_map, false,
+            "Match relationships of the Memgraph source by internal ids of "
+            "the destination nodes, which are kept in memory for each source "
+            "node. Otherwise, nodes are temporarily labeled and indexed by "
+            "their source ids, which are removed by full-graph passes once "
+            "the migration is done.");
+DEFINE_int64(cleanup_chunk_size, 100000,
+             "Maximum number of nodes whose internal label and property are "
+             "removed by a single transaction once the Memgraph migration is "
+             "done. It limits the memory used by the destination during the "
+             "cleanup. If set to 0, all nodes are cleaned up by a single "
+             "transaction.");
+DEFINE_int32(supernode_degree, 1000,
+             "Number of relationships of a single node after which the node "
+             "is treated as a supernode. Relationships of SQL tables are "
+             "routed to destination connections by their endpoints, and "
+             "relationships of supernodes are written by a dedicated "
+             "connection when there are more than two connections. Degrees "
+             "are counted by a separate scan of each relationship table "
+             "before its relationships are written, so each of those tables "
+             "is read twice from the source. Degrees are counted in a fixed "
+             "8 MiB table, which may overestimate the degrees of some nodes "
+             "of very large tables. Relationships are written by a single "
+             "connection per routed endpoint, but the other endpoint may "
+             "still conflict. If it's set to 0, relationships are routed by "
+             "their end nodes only, and tables are scanned once.");
+DEFINE_bool(adaptive_batching, false,
+            "Adjust the batch size and the number of active destination "
+            "connections (up to --destination_connections) while writing, "
+            "based on the measured throughput, latency and conflicts. "
+            "Settings tuned for each table are logged, so they can be reused "
+            "by later runs. --batch_size is used as the initial batch size. "
+            "The number of connections isn't tuned while relationships are "
+            "routed to dedicated connections, e.g. those of SQL tables.");
+DEFINE_int32(batch_latency_budget_ms, 500,
+             "Maximum average time in milliseconds it should take to write a "
+             "batch when --adaptive_batching is set.");
+DEFINE_int64(destination_memory_budget, 256 * 1024 * 1024,
+             "Maximum estimated size in bytes of all uncommitted destination "
+             "transactions when --adaptive_batching is set.");
+DEFINE_double(destination_memory_threshold, 0,
+              "Fraction of the destination memory limit after which writes "
+              "are paused until the destination frees enough memory. If it's "
+              "set to 0, destination memory usage isn't monitored.");
+DEFINE_int64(destination_memory_limit, 0,
+             "Memory limit of the destination in bytes used with "
+             "--destination_memory_threshold. If it's set to 0, the limit "
+             "reported by the destination is used.");
+DEFINE_int32(destination_memory_poll_ms, 1000,
+             "Interval in milliseconds between polls of the destination "
+             "memory usage when --destination_memory_threshold is set.");
+DEFINE_int32(destination_memory_max_pause_s, 600,
+             "Maximum time in seconds for which writes are paused by "
+             "--destination_memory_threshold. If the destination memory usage "
+             "doesn't drop in time, the migration is aborted, since the "
+             "committed data probably doesn't fit below the threshold. If it's "
+             "set to 0, writes are paused for as long as needed.");
+DEFINE_bool(verify_counts, false,
+            "Check only the total number of relationships created by each "
+            "destination batch instead of the number created for each row, "
+            "and compare the numbers of nodes per label and relationships per "
+            "edge type with the destination once the data is migrated.");
+DEFINE_int32(max_retries, 10,
+             "Maximum number of times a destination transaction is retried "
+             "after it conflicts with another transaction. Other failures "
+             "aren't retried, since the transaction might have been "
+             "committed. Batches that couldn't be written are logged and the "
+             "migration is aborted.");
 
 /// Compares if two endpoints are the same.
 // TODO(tsabolcec): We should check if endpoints matches only if the source
@@ -55,109 +232,621 @@ bool DoEndpointsMatch(const std::string_view &host1, uint16_t port1,
   return host1 == host2 && port1 == port2;
 }
 
-/// Migrates data from the `source` Memgraph database to the `destination`
-/// Memgraph database.
-void MigrateMemgraphDatabase(MemgraphSource *source,
-                             MemgraphClient *destination) {
+/// Returns batching options set by the command line flags.
+BatchOptions GetBatchOptions() {
+  BatchOptions options;
+  options.batch_size = FLAGS_batch_size;
+  options.transaction_batches = FLAGS_transaction_batches;
+  options.transaction_bytes = FLAGS_transaction_bytes;
+  options.window = FLAGS_destination_window;
+  // Rolled back transactions keep their writes while bulk loading, so
+  // retrying them would duplicate the data.
+  options.max_retries = FLAGS_bulk_load ? 0 : FLAGS_max_retries;
+  return options;
+}
+
+/// Checks that exactly one relationship was created for each row of a batch,
+/// or that the batch created one relationship per row in total if it's
+/// counted per batch. Merged batches are skipped because existing
+/// relationships aren't created again.
+void CheckRelationshipsCreated(const CompiledQuery &query, size_t rows,
+                               const std::vector<size_t> &created) {
+  if (query.use_merge) {
+    return;
+  }
+  if (query.count_per_batch) {
+    CHECK(created.size() == 1 && created[0] == rows)
+        << "Unexpected number of relationships created!";
+    return;
+  }
+  for (const auto count : created) {
+    CHECK(count == 1) << "Unexpected number of relationships created!";
+  }
+}
+
+/// Returns whether statements are written to files instead of a destination
+/// database.
+bool IsDestinationOffline() {
+  return !FLAGS_destination_cypherl_directory.empty();
+}
+
+/// Endpoint of a destination database.
+struct DestinationEndpoint {
+  std::string host;
+  uint16_t port;
+};
+
+/// Returns the destination endpoints set by `--destinations`, or the single
+/// endpoint set by `--destination_host` and `--destination_port`.
+std::vector<DestinationEndpoint> GetDestinationEndpoints() {
+  if (FLAGS_destinations.empty()) {
+    return {{FLAGS_destination_host,
+             static_cast<uint16_t>(FLAGS_destination_port)}};
+  }
+  std::vector<DestinationEndpoint> endpoints;
+  std::istringstream stream(FLAGS_destinations);
+  std::string endpoint;
+  while (std::getline(stream, endpoint, ',')) {
+    const auto colon = endpoint.rfind(':');
+    int port = 0;
+    if (colon != std::string::npos && colon > 0) {
+      try {
+        port = std::stoi(endpoint.substr(colon + 1));
+      } catch (const std::exception &) {
+      }
+    }
+    CHECK(port > 0 && port <= 65535)
+        << "Please specify destinations as host:port, got '" << endpoint
+        << "'.";
+    endpoints.push_back(
+        {endpoint.substr(0, colon), static_cast<uint16_t>(port)});
+  }
+  return endpoints;
+}
+
+/// Creates a connection to the destination database at the given `endpoint`,
+/// or a client of the `.cypherl` dump if the destination is offline. Returns a
+/// `nullptr` if the connection couldn't be established.
+std::unique_ptr<MemgraphClient> ConnectToDestination(
+    const DestinationEndpoint &endpoint) {
+  if (IsDestinationOffline()) {
+    static auto dump = std::make_shared<CypherlDump>(
+        FLAGS_destination_cypherl_directory,
+        FLAGS_destination_cypherl_statements);
+    return std::make_unique<CypherlFileClient>(dump);
+  }
+  return MemgraphClientConnection::Connect(
+      {.host = endpoint.host,
+       .port = endpoint.port,
+       .username = FLAGS_destination_username,
+       .password = FLAGS_destination_password,
+       .use_ssl = FLAGS_destination_use_ssl});
+}
+
+/// Destination database, together with its connection used for schema
+/// changes, and its bulk load session, if any.
+struct Destination {
+  DestinationEndpoint endpoint;
+  std::unique_ptr<MemgraphClient> client;
+  std::unique_ptr<BulkLoadSession> bulk_load;
+};
+
+/// Creates a pool of writers with the `--destination_connections` number of
+/// connections to the destination database at the given `endpoint`, next to
+/// the connection used for schema changes.
+std::unique_ptr<WriterPool> CreateWriterPool(
+    const DestinationEndpoint &endpoint, const BatchOptions &options,
+    WriterPool::NodeIdsCallback node_ids_callback = {}) {
+  std::vector<std::unique_ptr<MemgraphClient>> clients;
+  clients.reserve(FLAGS_destination_connections);
+  for (int i = 0; i < FLAGS_destination_connections; ++i) {
+    auto client = ConnectToDestination(endpoint);
+    CHECK(client) << "Couldn't connect to the destination Memgraph database.";
+    clients.push_back(std::move(client));
+  }
+  // Offline destination doesn't report created relationships.
+  WriterPool::CreatedCallback created_callback;
+  if (!IsDestinationOffline()) {
+    created_callback = CheckRelationshipsCreated;
+  }
+  return std::make_unique<WriterPool>(std::move(clients), options,
+                                      std::move(created_callback),
+                                      std::move(node_ids_callback));
+}
+
+/// Creates a batch controller for the given `writer` if adaptive batching is
+/// enabled. Returns a `nullptr` otherwise.
+std::unique_ptr<BatchController> CreateBatchController(
+    const BatchOptions &options, WriterPool *writer) {
+  if (!FLAGS_adaptive_batching) {
+    return nullptr;
+  }
+  BatchController::Options controller_options;
+  controller_options.initial_batch_size = options.batch_size;
+  controller_options.max_writers = writer->lanes();
+  controller_options.transaction_batches = options.transaction_batches;
+  controller_options.latency_budget =
+      std::chrono::milliseconds(FLAGS_batch_latency_budget_ms);
+  controller_options.memory_budget = FLAGS_destination_memory_budget;
+  auto controller = std::make_unique<BatchController>(controller_options);
+  writer->set_controller(controller.get());
+  return controller;
+}
+
+/// Creates a monitor of the memory usage of the destination at the given
+/// `endpoint` for its `writer` if `--destination_memory_threshold` is set.
+/// Returns a `nullptr` otherwise.
+std::unique_ptr<MemoryMonitor> CreateMemoryMonitor(
+    const DestinationEndpoint &endpoint, WriterPool *writer) {
+  if (FLAGS_destination_memory_threshold == 0) {
+    return nullptr;
+  }
+  auto client = ConnectToDestination(endpoint);
+  CHECK(client) << "Couldn't connect to the destination Memgraph database.";
+  auto monitor = std::make_unique<MemoryMonitor>(
+      std::move(client), FLAGS_destination_memory_threshold,
+      FLAGS_destination_memory_limit,
+      std::chrono::milliseconds(FLAGS_destination_memory_poll_ms),
+      std::chrono::seconds(FLAGS_destination_memory_max_pause_s));
+  writer->set_memory_monitor(monitor.get());
+  return monitor;
+}
+
+/// Executes the schema `plan` on each of the `destinations`, using the
+/// destination connection together with additional connections up to
+/// `--destination_connections` in total.
+void ExecuteSchemaPlan(const SchemaPlan &plan,
+                       const std::vector<Destination> &destinations) {
+  const auto connections = std::min<size_t>(
+      std::max(FLAGS_destination_connections, 1), plan.size());
+  for (const auto &destination : destinations) {
+    std::vector<std::unique_ptr<MemgraphClient>> additional_clients;
+    std::vector<MemgraphClient *> clients{destination.client.get()};
+    for (size_t i = 1; i < connections; ++i) {
+      auto client = ConnectToDestination(destination.endpoint);
+      CHECK(client)
+          << "Couldn't connect to the destination Memgraph database.";
+      clients.push_back(client.get());
+      additional_clients.push_back(std::move(client));
+    }
+    plan.Execute(clients);
+  }
+}
+
+/// Should be called before and after relationships are written to the
+/// `destinations`, so that their bulk load sessions, if any, can prepare for
+/// them.
+void BeginRelationships(const std::vector<Destination> &destinations) {
+  for (const auto &destination : destinations) {
+    if (destination.bulk_load) {
+      destination.bulk_load->BeginRelationships();
+    }
+  }
+}
+
+void EndRelationships(const std::vector<Destination> &destinations) {
+  for (const auto &destination : destinations) {
+    if (destination.bulk_load) {
+      destination.bulk_load->EndRelationships();
+    }
+  }
+}
+
+/// Label of ghost nodes that represent nodes of a Memgraph source stored by
+/// another shard. Ghosts of SQL rows are labeled by the table name prefixed
+/// with it instead.
+const char *kGhostLabel = "__mg_ghost__";
+
+/// Returns the map of nodes to shards if `--shard_destinations` is set, where
+/// each of the `destinations` is a shard. Returns `std::nullopt` otherwise.
+std::optional<ShardMap> GetShardMap(
+    const std::vector<Destination> &destinations) {
+  if (!FLAGS_shard_destinations) {
+    return std::nullopt;
+  }
+  return ShardMap(destinations.size(), ParseLabelShards(FLAGS_shard_labels));
+}
+
+CrossShardPolicy GetCrossShardPolicy() {
+  return FLAGS_cross_shard_relationships == "skip" ? CrossShardPolicy::kSkip
+                                                   : CrossShardPolicy::kGhost;
+}
+
+/// Logs the number of cross-shard relationships that were written with
+/// ghost end nodes, or skipped, depending on the policy.
+void LogCrossShardRelationships(size_t count) {
+  if (count == 0) {
+    return;
+  }
+  if (GetCrossShardPolicy() == CrossShardPolicy::kGhost) {
+    LOG(INFO) << "Wrote " << count
+              << " cross-shard relationships with ghost end nodes";
+  } else {
+    LOG(WARNING) << "Skipped " << count << " cross-shard relationships";
+  }
+}
+
+/// Verifies the rows counted by the `verifier`, if any, on each of the
+/// `destinations`.
+void VerifyCounts(const CountVerifier *verifier,
+                  const std::vector<Destination> &destinations) {
+  if (!verifier) {
+    return;
+  }
+  for (const auto &destination : destinations) {
+    verifier->Verify(destination.client.get());
+  }
+}
+
+/// Map from internal ids of source nodes to internal ids of the nodes created
+/// for them in the destination. It's filled by the writing threads.
+class NodeIdMap {
+ public:
+  void Insert(const std::vector<std::pair<int64_t, int64_t>> &ids) {
+    std::lock_guard<std::mutex> guard(lock_);
+    for (const auto &[source_id, destination_id] : ids) {
+      ids_[source_id] = destination_id;
+    }
+  }
+
+  /// Returns the destination id of the given source node. It should be called
+  /// only once all of the nodes are written.
+  int64_t Get(int64_t source_id) const {
+    auto it = ids_.find(source_id);
+    CHECK(it != ids_.end())
+        << "Relationship references a node that wasn't migrated!";
+    return it->second;
+  }
+
+ private:
+  std::mutex lock_;
+  std::unordered_map<int64_t, int64_t> ids_;
+};
+
+/// Writes batches to a single destination. Each pipeline has its own writer
+/// pool, whose queue holds at most `--destination_window` batches, so a slow
+/// destination stalls the shared source scan, and with it the other
+/// destinations, only once its own queue is full. If `map_node_ids` is set,
+/// internal ids of the created nodes are collected in the `id_map`.
+struct DestinationPipeline {
+  DestinationPipeline(const Destination &destination,
+                      const BatchOptions &options, bool map_node_ids)
+      : destination(&destination),
+        writer(CreateWriterPool(
+            destination.endpoint, options,
+            map_node_ids ? WriterPool::NodeIdsCallback(
+                               [this](const auto &ids) { id_map.Insert(ids); })
+                         : WriterPool::NodeIdsCallback())),
+        controller(CreateBatchController(options, writer.get())),
+        memory_monitor(CreateMemoryMonitor(destination.endpoint, writer.get())),
+        batcher(writer.get(), options, controller.get()) {}
+
+  const Destination *destination;
+  NodeIdMap id_map;
+  std::unique_ptr<WriterPool> writer;
+  std::unique_ptr<BatchController> controller;
+  std::unique_ptr<MemoryMonitor> memory_monitor;
+  Batcher batcher;
+};
+
+using DestinationPipelines = std::vector<std::unique_ptr<DestinationPipeline>>;
+
+/// Creates a pipeline for each of the `destinations`.
+DestinationPipelines CreatePipelines(
+    const std::vector<Destination> &destinations, const BatchOptions &options,
+    bool map_node_ids = false) {
+  DestinationPipelines pipelines;
+  pipelines.reserve(destinations.size());
+  for (const auto &destination : destinations) {
+    pipelines.push_back(std::make_unique<DestinationPipeline>(
+        destination, options, map_node_ids));
+  }
+  return pipelines;
+}
+
+/// Adds the `row` bound to the `query` to each of the `pipelines`, to be
+/// written to the given writer `lane`. The row is copied for all but the last
+/// pipeline.
+void AddRow(const DestinationPipelines &pipelines, const CompiledQuery *query,
+            mg::List row, size_t lane = WriterPool::kAnyLane) {
+  for (size_t i = 0; i + 1 < pipelines.size(); ++i) {
+    pipelines[i]->batcher.Add(query, mg::List(row), lane);
+  }
+  pipelines.back()->batcher.Add(query, std::move(row), lane);
+}
+
+/// Flushes each of the `pipelines`, and logs the settings tuned for the named
+/// part of the migration, e.g. a single table.
+void FlushPipelines(const DestinationPipelines &pipelines,
+                    const std::string &name) {
+  for (const auto &pipeline : pipelines) {
+    pipeline->batcher.Flush();
+    if (pipeline->controller) {
+      const auto &endpoint = pipeline->destination->endpoint;
+      pipeline->controller->LogSummary(
+          pipelines.size() == 1 ? name
+                                : name + " on " + endpoint.host + ":" +
+                                      std::to_string(endpoint.port));
+    }
+  }
+}
+
+/// Asks the destinations of the `pipelines` to free memory between migration
+/// phases if their memory usage is monitored.
+void FreeDestinationMemory(const DestinationPipelines &pipelines) {
+  for (const auto &pipeline : pipelines) {
+    if (pipeline->memory_monitor) {
+      pipeline->memory_monitor->FreeMemory();
+    }
+  }
+}
+
+/// Migrates nodes and relationships from the `source` Memgraph database by
+/// matching relationship endpoints by internal ids of the destination nodes.
+/// Migrated rows are counted by the `verifier`, if any.
+void MigrateMemgraphGraphByIds(MemgraphSource *source,
+                               const std::vector<Destination> &destinations,
+                               const BatchOptions &options,
+                               CountVerifier *verifier) {
+  QueryShapeCache query_cache;
+  auto pipelines = CreatePipelines(destinations, options, true);
+
+  // Migrate nodes.
+  source->ReadNodes([&query_cache, &pipelines, verifier](const auto &node) {
+    NodeShape shape;
+    shape.return_ids = true;
+    shape.property_map = true;
+    shape.labels.insert(node.labels.begin(), node.labels.end());
+    mg::List row(2);
+    row.Append(mg::Value(node.id));
+    row.Append(mg::Value(mg::Map(node.properties)));
+    const auto *query = query_cache.Get(shape);
+    if (verifier) {
+      verifier->Expect(query);
+    }
+    AddRow(pipelines, query, std::move(row));
+  });
+  FlushPipelines(pipelines, "nodes");
+  FreeDestinationMemory(pipelines);
+
+  // Migrate relationships. Nodes have different internal ids in each of the
+  // destinations, so each of them gets its own row.
+  BeginRelationships(destinations);
+  source->ReadRelationships(
+      [&query_cache, &pipelines, verifier](const auto &rel) {
+        RelationshipShape shape;
+        shape.match_ids = true;
+        shape.count_per_batch = FLAGS_verify_counts;
+        shape.edge_type = rel.type;
+        shape.property_map = true;
+        const auto *query = query_cache.Get(shape);
+        if (verifier) {
+          verifier->Expect(query);
+        }
+        for (const auto &pipeline : pipelines) {
+          mg::List row(3);
+          row.Append(mg::Value(pipeline->id_map.Get(rel.from)));
+          row.Append(mg::Value(pipeline->id_map.Get(rel.to)));
+          row.Append(mg::Value(mg::Map(rel.properties)));
+          pipeline->batcher.Add(query, std::move(row));
+        }
+      });
+  FlushPipelines(pipelines, "relationships");
+  EndRelationships(destinations);
+}
+
+/// Migrates nodes and relationships from the `source` Memgraph database by
+/// matching relationship endpoints by their source ids, which are stored in
+/// the destination under an internal label and property. Migrated rows are
+/// counted by the `verifier`, if any, and verified before the internal label
+/// is removed. If the destinations are shards, each node is written only to
+/// its own shard, and source ids are kept for ghost nodes to refer to.
+void MigrateMemgraphGraphByProperties(
+    MemgraphSource *source, const std::vector<Destination> &destinations,
+    const BatchOptions &options, CountVerifier *verifier) {
   const char *internal_node_label = "__mg_vertex__";
   const char *internal_property_id = "__mg_id__";
+  QueryShapeCache query_cache;
+  auto pipelines = CreatePipelines(destinations, options);
+  const auto shard_map = GetShardMap(destinations);
+  const bool use_ghosts =
+      shard_map && GetCrossShardPolicy() == CrossShardPolicy::kGhost;
+  // Shards of nodes assigned by their labels, which relationships don't have.
+  std::unordered_map<int64_t, size_t> node_shards;
+  const auto get_node_shard = [&shard_map, &node_shards,
+                               &internal_node_label](int64_t id) {
+    if (!shard_map->has_label_shards()) {
+      return shard_map->GetShard(internal_node_label, id);
+    }
+    auto it = node_shards.find(id);
+    CHECK(it != node_shards.end())
+        << "Relationship references a node that wasn't migrated!";
+    return it->second;
+  };
+
   // Migrate nodes.
-  source->ReadNodes([&destination, &internal_node_label,
-                     &internal_property_id](const auto &node) {
-    std::set<std::string> label_set;
-    label_set.emplace(internal_node_label);
-    for (const auto &label : node.labels()) {
-      label_set.emplace(label);
-    }
-    mg::Map properties(node.properties().size() + 1);
-    properties.InsertUnsafe(internal_property_id, mg::Value(node.id().AsInt()));
-    for (const auto &[key, value] : node.properties()) {
-      properties.InsertUnsafe(key, value);
-    }
-    CreateNode(destination, label_set, properties.AsConstMap());
+  source->ReadNodes([&query_cache, &pipelines, &internal_node_label,
+                     &internal_property_id, verifier, &shard_map,
+                     &node_shards](const auto &node) {
+    NodeShape shape;
+    shape.labels.emplace(internal_node_label);
+    shape.labels.insert(node.labels.begin(), node.labels.end());
+    shape.properties.emplace_back(internal_property_id);
+    shape.property_map = true;
+    mg::List row(2);
+    row.Append(mg::Value(node.id));
+    row.Append(mg::Value(mg::Map(node.properties)));
+    const auto *query = query_cache.Get(shape);
+    if (verifier) {
+      verifier->Expect(query);
+    }
+    if (!shard_map) {
+      AddRow(pipelines, query, std::move(row));
+      return;
+    }
+    std::optional<size_t> shard;
+    for (const auto &label : node.labels) {
+      if (!shard) {
+        shard = shard_map->GetLabelShard(label);
+      }
+    }
+    if (!shard) {
+      shard = shard_map->GetShard(internal_node_label, node.id);
+    }
+    if (shard_map->has_label_shards()) {
+      node_shards.emplace(node.id, *shard);
+    }
+    pipelines[*shard]->batcher.Add(query, std::move(row));
   });
+  FlushPipelines(pipelines, "nodes");
+  FreeDestinationMemory(pipelines);
 
-  // Create internal label+id index.
-  CreateLabelPropertyIndex(destination, internal_node_label,
-                           internal_property_id);
-
-  // Migrate relationships.
-  source->ReadRelationships([&destination, &internal_node_label,
-                             &internal_property_id](const auto &rel) {
-    mg::Map id1(1);
-    mg::Map id2(1);
-    id1.InsertUnsafe(internal_property_id, mg::Value(rel.from().AsInt()));
-    id2.InsertUnsafe(internal_property_id, mg::Value(rel.to().AsInt()));
-    CHECK(CreateRelationships(destination, internal_node_label,
-                              id1.AsConstMap(), internal_node_label,
-                              id2.AsConstMap(), rel.type(),
-                              rel.properties()) == 1)
-        << "Unexpected number of relationships created!";
+  // Create internal label+id indices.
+  SchemaPlan internal_indices;
+  internal_indices.CreateLabelPropertyIndex(internal_node_label,
+                                            internal_property_id);
+  if (use_ghosts) {
+    internal_indices.CreateLabelPropertyIndex(kGhostLabel,
+                                              internal_property_id);
+  }
+  ExecuteSchemaPlan(internal_indices, destinations);
+
+  // Migrate relationships. Relationships to ghosts are routed by the ghost
+  // key, so that the same ghost isn't merged by concurrent transactions.
+  BeginRelationships(destinations);
+  size_t cross_shard = 0;
+  // All of the destinations have the same number of lanes.
+  RelationshipRouter ghost_router(pipelines.front()->writer->lanes(),
+                                  FLAGS_supernode_degree);
+  source->ReadRelationships([&query_cache, &pipelines, &internal_node_label,
+                             &internal_property_id, verifier, &shard_map,
+                             &get_node_shard, use_ghosts, &ghost_router,
+                             &cross_shard](const auto &rel) {
+    RelationshipShape shape;
+    shape.count_per_batch = FLAGS_verify_counts;
+    shape.label1 = internal_node_label;
+    shape.id1.emplace_back(internal_property_id);
+    shape.label2 = internal_node_label;
+    shape.id2.emplace_back(internal_property_id);
+    shape.edge_type = rel.type;
+    shape.property_map = true;
+    mg::List row(3);
+    row.Append(mg::Value(rel.from));
+    row.Append(mg::Value(rel.to));
+    row.Append(mg::Value(mg::Map(rel.properties)));
+    if (!shard_map) {
+      const auto *query = query_cache.Get(shape);
+      if (verifier) {
+        verifier->Expect(query);
+      }
+      AddRow(pipelines, query, std::move(row));
+      return;
+    }
+    const auto shard = get_node_shard(rel.from);
+    if (get_node_shard(rel.to) != shard) {
+      ++cross_shard;
+      if (!use_ghosts) {
+        return;
+      }
+      shape.label2 = kGhostLabel;
+      shape.merge_end = true;
+    }
+    const auto *query = query_cache.Get(shape);
+    const auto lane = shape.merge_end ? ghost_router.Route(*query, row)
+                                      : WriterPool::kAnyLane;
+    pipelines[shard]->batcher.Add(query, std::move(row), lane);
   });
+  FlushPipelines(pipelines, "relationships");
+  EndRelationships(destinations);
+  LogCrossShardRelationships(cross_shard);
+
+  VerifyCounts(verifier, destinations);
+
+  // Remove internal labels, properties and indices. The label index is used
+  // only to find the remaining labeled nodes in each chunk.
+  // Offline destination can't report the number of cleaned up nodes, so
+  // it's cleaned up in a single transaction.
+  const size_t chunk_size =
+      IsDestinationOffline() ? 0 : FLAGS_cleanup_chunk_size;
+  // Ghost nodes refer to nodes of other shards by their source ids, so the
+  // ids are kept.
+  std::vector<std::string> internal_properties;
+  if (!use_ghosts) {
+    internal_properties.emplace_back(internal_property_id);
+  }
+  for (const auto &destination : destinations) {
+    auto *client = destination.client.get();
+    DropLabelPropertyIndex(client, internal_node_label, internal_property_id);
+    if (use_ghosts) {
+      DropLabelPropertyIndex(client, kGhostLabel, internal_property_id);
+    }
+    if (chunk_size > 0) {
+      CreateLabelIndex(client, internal_node_label);
+    }
+    RemoveLabelFromNodes(client, internal_node_label, internal_properties,
+                         chunk_size);
+    if (chunk_size > 0) {
+      DropLabelIndex(client, internal_node_label);
+    }
+  }
+}
+
+/// Migrates data from the `source` Memgraph database to each of the
+/// `destinations`, reading the source only once.
+void MigrateMemgraphDatabase(MemgraphSource *source,
+                             const std::vector<Destination> &destinations) {
+  const auto options = GetBatchOptions();
+  std::unique_ptr<CountVerifier> verifier;
+  if (FLAGS_verify_counts) {
+    verifier = std::make_unique<CountVerifier>();
+  }
+  if (FLAGS_memgraph_id_map) {
+    MigrateMemgraphGraphByIds(source, destinations, options, verifier.get());
+    VerifyCounts(verifier.get(), destinations);
+  } else {
+    MigrateMemgraphGraphByProperties(source, destinations, options,
+                                     verifier.get());
+  }
 
-  // Migrate indices.
+  // Migrate indices and constraints once all of the data is migrated.
+  SchemaPlan schema_plan;
   const auto &index_info = source->ReadIndices();
   for (const auto &label : index_info.label) {
-    CreateLabelIndex(destination, label);
+    schema_plan.CreateLabelIndex(label);
   }
   for (const auto &[label, property] : index_info.label_property) {
-    CreateLabelPropertyIndex(destination, label, property);
+    schema_plan.CreateLabelPropertyIndex(label, property);
   }
-
-  // Migrate constraints.
   const auto &constraint_info = source->ReadConstraints();
   for (const auto &[label, property] : constraint_info.existence) {
-    CreateExistenceConstraint(destination, label, property);
+    schema_plan.CreateExistenceConstraint(label, property);
   }
   for (const auto &[label, properties] : constraint_info.unique) {
-    CreateUniqueConstraint(destination, label, properties);
-  }
-
-  // Remove internal labels, properties and indices.
-  DropLabelPropertyIndex(destination, internal_node_label,
-                         internal_property_id);
-  RemoveLabelFromNodes(destination, internal_node_label);
-  RemovePropertyFromNodes(destination, internal_property_id);
-}
-
-/// Helper function that, given the `table`, result `row` and list of
-/// `positions`, returns a subset of result columns as a map.
-mg::Map ExtractProperties(const SchemaInfo::Table &table,
-                          const std::vector<mg::Value> &row,
-                          const std::vector<size_t> &positions) {
-  CHECK(table.columns.size() == row.size())
-      << "Result size doesn't match column size of the table!";
-  mg::Map properties(positions.size());
-  for (const auto &pos : positions) {
-    CHECK(pos < row.size())
-        << "Couldn't access result for the given column (index out of bounds)!";
-    properties.InsertUnsafe(table.columns[pos], row[pos]);
-  }
-  return properties;
-}
-
-/// Helper function that returns map of properties of foreign key columns that
-/// can be used to match corresponding row of the parent table.
-mg::Map ConstructForeignKeyMatcher(const SchemaInfo &schema,
-                                   const SchemaInfo::ForeignKey &foreign_key,
-                                   const std::vector<mg::Value> &row) {
-  mg::Map properties(foreign_key.child_columns.size());
-  for (size_t i = 0; i < foreign_key.child_columns.size(); ++i) {
-    const auto child_pos = foreign_key.child_columns[i];
-    const auto parent_pos = foreign_key.parent_columns[i];
-    const auto &parent_table = schema.tables[foreign_key.parent_table];
-    CHECK(child_pos < row.size());
-    CHECK(parent_pos < parent_table.columns.size());
-    properties.InsertUnsafe(parent_table.columns[parent_pos], row[child_pos]);
-  }
-  return properties;
-}
-
-/// Helper function that checks whether the `properties` corresponds to a well
-/// defined foreign key (which doesn't contain any null values).
-bool IsForeignKeyMatcherWellDefined(const mg::ConstMap &properties) {
-  for (const auto &[_, value] : properties) {
-    if (value.type() == mg::Value::Type::Null) {
+    schema_plan.CreateUniqueConstraint(label, properties);
+  }
+  ExecuteSchemaPlan(schema_plan, destinations);
+}
+
+/// Helper function that returns names of the `table` columns at the given
+/// `positions`.
+std::vector<std::string> GetColumnNames(const SchemaInfo::Table &table,
+                                        const std::vector<size_t> &positions) {
+  std::vector<std::string> names;
+  names.reserve(positions.size());
+  for (const auto pos : positions) {
+    CHECK(pos < table.columns.size());
+    names.emplace_back(table.columns[pos]);
+  }
+  return names;
+}
+
+/// Helper function that checks whether the foreign key columns of the `row`
+/// are well defined (they don't contain any null values).
+bool IsForeignKeyWellDefined(const SchemaInfo::ForeignKey &foreign_key,
+                             const std::vector<mg::Value> &row) {
+  for (const auto pos : foreign_key.child_columns) {
+    CHECK(pos < row.size());
+    if (row[pos].type() == mg::Value::Type::Null) {
       return false;
     }
   }
@@ -180,12 +869,207 @@ std::string GetTableName(const SchemaInfo::Table &table) {
   return table.schema + "_" + table.name;
 }
 
+/// Writes rows of compiled queries through the `pipelines`, or stages them for
+/// LOAD CSV if the `csv_loader` is set. Rows are counted by the `verifier`, if
+/// any.
+class SqlRowWriter {
+ public:
+  SqlRowWriter(const DestinationPipelines *pipelines, CsvLoader *csv_loader,
+               CountVerifier *verifier)
+      : pipelines_(pipelines), csv_loader_(csv_loader), verifier_(verifier) {}
+
+  template <typename Shape>
+  void Register(const CompiledQuery *query, const Shape &shape) {
+    if (csv_loader_) {
+      csv_loader_->Register(query, shape);
+    }
+  }
+
+  void Add(const CompiledQuery *query, mg::List row,
+           size_t lane = WriterPool::kAnyLane) {
+    if (verifier_) {
+      verifier_->Expect(query);
+    }
+    if (csv_loader_) {
+      csv_loader_->Add(query, row);
+    } else {
+      AddRow(*pipelines_, query, std::move(row), lane);
+    }
+  }
+
+  /// Same as `Add`, but the row is written only to the given `shard`.
+  void AddToShard(size_t shard, const CompiledQuery *query, mg::List row,
+                  size_t lane = WriterPool::kAnyLane) {
+    if (verifier_) {
+      verifier_->Expect(query);
+    }
+    CHECK(!csv_loader_) << "Staged rows can't be written to shards!";
+    (*pipelines_)[shard]->batcher.Add(query, std::move(row), lane);
+  }
+
+  /// Writes all of the remaining rows of the named part of the migration, e.g.
+  /// a single table.
+  void Flush(const std::string &name) {
+    if (csv_loader_) {
+      csv_loader_->Flush();
+    } else {
+      FlushPipelines(*pipelines_, name);
+    }
+  }
+
+ private:
+  const DestinationPipelines *pipelines_;
+  CsvLoader *csv_loader_;
+  CountVerifier *verifier_;
+};
+
+/// Relationships created from the rows of a single table. Each of the
+/// compiled `queries` binds a row only if all of its foreign keys are well
+/// defined.
+struct TableRelationships {
+  const SchemaInfo::Table *table;
+  std::vector<RelationshipShape> shapes;
+  std::vector<const CompiledQuery *> queries;
+  std::vector<std::vector<const SchemaInfo::ForeignKey *>> foreign_keys;
+  std::vector<std::vector<BindingStep>> plans;
+  /// Queries which merge ghost end nodes instead, if relationships are
+  /// written to shards.
+  std::vector<const CompiledQuery *> ghost_queries;
+};
+
+/// Helper function that compiles queries which create relationships from the
+/// rows of the given `table`.
+TableRelationships GetTableRelationships(const SchemaInfo &schema,
+                                         const SchemaInfo::Table &table,
+                                         QueryShapeCache *query_cache) {
+  TableRelationships relationships{&table, {}, {}, {}, {}, {}};
+  std::vector<std::vector<size_t>> positions;
+  if (IsTableRelationship(table)) {
+    const auto &foreign_key1 = schema.foreign_keys[table.foreign_keys[0]];
+    const auto &foreign_key2 = schema.foreign_keys[table.foreign_keys[1]];
+    const auto &parent_table1 = schema.tables[foreign_key1.parent_table];
+    const auto &parent_table2 = schema.tables[foreign_key2.parent_table];
+    std::vector<size_t> property_positions;
+    for (size_t i = 0; i < table.columns.size(); ++i) {
+      if (!utils::Contains(foreign_key1.child_columns, i) &&
+          !utils::Contains(foreign_key2.child_columns, i)) {
+        property_positions.push_back(i);
+      }
+    }
+    RelationshipShape shape;
+    shape.label1 = GetTableName(parent_table1);
+    shape.id1 = GetColumnNames(parent_table1, foreign_key1.parent_columns);
+    shape.label2 = GetTableName(parent_table2);
+    shape.id2 = GetColumnNames(parent_table2, foreign_key2.parent_columns);
+    shape.edge_type = GetTableName(table);
+    shape.properties = GetColumnNames(table, property_positions);
+    shape.count_per_batch = FLAGS_verify_counts;
+    relationships.queries.push_back(query_cache->Get(shape));
+    relationships.shapes.push_back(std::move(shape));
+    relationships.foreign_keys.push_back({&foreign_key1, &foreign_key2});
+    positions.push_back(foreign_key1.child_columns);
+    positions.back().insert(positions.back().end(),
+                            foreign_key2.child_columns.begin(),
+                            foreign_key2.child_columns.end());
+    positions.back().insert(positions.back().end(),
+                            property_positions.begin(),
+                            property_positions.end());
+  } else {
+    // If there is no primary key, use all columns to match a node.
+    std::vector<size_t> id_positions(table.primary_key);
+    if (id_positions.empty()) {
+      for (size_t i = 0; i < table.columns.size(); ++i) {
+        id_positions.push_back(i);
+      }
+    }
+    for (const auto &fk_pos : table.foreign_keys) {
+      const auto &foreign_key = schema.foreign_keys[fk_pos];
+      const auto &parent_table = schema.tables[foreign_key.parent_table];
+      RelationshipShape shape;
+      shape.label1 = GetTableName(table);
+      shape.id1 = GetColumnNames(table, id_positions);
+      shape.label2 = GetTableName(parent_table);
+      shape.id2 = GetColumnNames(parent_table, foreign_key.parent_columns);
+      shape.edge_type = shape.label1 + "_to_" + shape.label2;
+      // If there is no primary key, use `MERGE` instead of `CREATE` to
+      // prevent creating duplicate relationships.
+      shape.use_merge = table.primary_key.empty();
+      shape.count_per_batch = FLAGS_verify_counts;
+      relationships.queries.push_back(query_cache->Get(shape));
+      relationships.shapes.push_back(std::move(shape));
+      relationships.foreign_keys.push_back({&foreign_key});
+      positions.push_back(id_positions);
+      positions.back().insert(positions.back().end(),
+                              foreign_key.child_columns.begin(),
+                              foreign_key.child_columns.end());
+    }
+  }
+  relationships.plans = PlanBindings(positions);
+  return relationships;
+}
+
+/// Returns positions of `size` consecutive values starting at `begin`.
+std::vector<size_t> GetPositions(size_t begin, size_t size) {
+  std::vector<size_t> positions(size);
+  for (size_t i = 0; i < size; ++i) {
+    positions[i] = begin + i;
+  }
+  return positions;
+}
+
+/// Checks that nodes referenced by the `foreign_key` can be assigned to
+/// shards, i.e. that their label is mapped to a shard, or that the foreign
+/// key references the primary key of their table, which is hashed.
+void CheckShardableForeignKey(const SchemaInfo &schema,
+                              const SchemaInfo::ForeignKey &foreign_key,
+                              const ShardMap &shard_map) {
+  const auto &parent_table = schema.tables[foreign_key.parent_table];
+  if (shard_map.GetLabelShard(GetTableName(parent_table))) {
+    return;
+  }
+  const std::set<size_t> parent_columns(foreign_key.parent_columns.begin(),
+                                        foreign_key.parent_columns.end());
+  const std::set<size_t> primary_key(parent_table.primary_key.begin(),
+                                     parent_table.primary_key.end());
+  CHECK(!primary_key.empty() && parent_columns == primary_key)
+      << "Table " << GetTableName(parent_table)
+      << " is referenced by columns other than its primary key, so its rows "
+         "can't be assigned to shards by a hash. Please map it to a shard by "
+         "--shard_labels.";
+}
+
+/// Migrates data from the `source` SQL database to each of the `destinations`,
+/// reading the source only once. If the destinations are shards, each row is
+/// written only to the shard of its node, or the start node of its
+/// relationship.
 template <typename Source>
-void MigrateSqlDatabase(Source *source, MemgraphClient *destination) {
+void MigrateSqlDatabase(Source *source,
+                        const std::vector<Destination> &destinations) {
   // Get SQL schema info.
   auto schema = source->GetSchemaInfo();
 
-  // Migrate rows of tables as nodes.
+  QueryShapeCache query_cache;
+  const auto options = GetBatchOptions();
+  auto pipelines = CreatePipelines(destinations, options);
+  std::unique_ptr<CsvLoader> csv_loader;
+  if (!FLAGS_csv_staging_directory.empty()) {
+    csv_loader = std::make_unique<CsvLoader>(
+        destinations.front().client.get(), FLAGS_csv_staging_directory,
+        FLAGS_csv_server_directory.empty() ? FLAGS_csv_staging_directory
+                                           : FLAGS_csv_server_directory,
+        FLAGS_csv_staging_rows);
+  }
+  std::unique_ptr<CountVerifier> verifier;
+  if (FLAGS_verify_counts) {
+    verifier = std::make_unique<CountVerifier>();
+  }
+  SqlRowWriter rows(&pipelines, csv_loader.get(), verifier.get());
+  const auto shard_map = GetShardMap(destinations);
+  const bool use_ghosts =
+      shard_map && GetCrossShardPolicy() == CrossShardPolicy::kGhost;
+
+  // Migrate rows of tables as nodes. Indices aren't created until all of the
+  // nodes are migrated, so that they aren't updated by every created node.
   DLOG(INFO) << "Migrating rows";
   for (const auto &table : schema.tables) {
     // If the table has exactly two foreign keys, it's better to represent it
@@ -193,117 +1077,153 @@ void MigrateSqlDatabase(Source *source, MemgraphClient *destination) {
     if (IsTableRelationship(table)) {
       continue;
     }
-    source->ReadTable(table, [&destination,
-                              &table](const std::vector<mg::Value> &row) {
-      // Row is converted to node by labeling a node by table name, and
-      // constructing properties as list of (column name, column value)
-      // pairs.
-      mg::Map properties(row.size());
-      for (size_t i = 0; i < row.size(); ++i) {
-        properties.InsertUnsafe(table.columns[i], row[i]);
+    // Row is converted to node by labeling a node by table name, and
+    // constructing properties as list of (column name, column value) pairs.
+    const auto label = GetTableName(table);
+    const NodeShape shape{{label}, table.columns};
+    const auto *query = query_cache.Get(shape);
+    rows.Register(query, shape);
+    // Nodes are assigned to shards by their primary key, or all of the
+    // columns if there isn't one, as they're matched by relationships.
+    auto key_positions = table.primary_key;
+    if (key_positions.empty()) {
+      key_positions = GetPositions(0, table.columns.size());
+    }
+    source->ReadTable(table, [&rows, &query, &shard_map, &label,
+                              &key_positions](std::vector<mg::Value> &&row) {
+      mg::List values(std::move(row));
+      if (shard_map) {
+        const auto shard = shard_map->GetShard(label, values, key_positions);
+        rows.AddToShard(shard, query, std::move(values));
+      } else {
+        rows.Add(query, std::move(values));
       }
-      CreateNode(destination, {GetTableName(table)}, properties.AsConstMap());
     });
-    if (!table.primary_key.empty()) {
-      // Create index for fast node matching. Memgraph doesn't support multiple
-      // properties for a single index, so we'll create index over only one
-      // primary index field.
-      // TODO: If Memgraph supports this feature in the future, create index
-      // over all primary key fields.
-      CreateLabelPropertyIndex(destination, GetTableName(table),
-                               table.columns[table.primary_key[0]]);
-    } else {
-      CreateLabelIndex(destination, GetTableName(table));
-    }
+    rows.Flush(GetTableName(table));
   }
 
-  // Migrate edges using foreign keys.
-  DLOG(INFO) << "Migrating edges";
+  // Create only the indices used for matching endpoints of relationships.
+  // Memgraph doesn't support multiple properties for a single index, so
+  // endpoints are indexed by their first id property.
+  // TODO: If Memgraph supports this feature in the future, create index
+  // over all id properties.
+  std::vector<TableRelationships> table_relationships;
+  SchemaPlan lookup_indices;
   for (const auto &table : schema.tables) {
     if (table.foreign_keys.empty()) {
       continue;
     }
-    if (IsTableRelationship(table)) {
-      source->ReadTable(table, [&destination, &schema,
-                                &table](const auto &row) {
-        const auto &foreign_key1 = schema.foreign_keys[table.foreign_keys[0]];
-        const auto &foreign_key2 = schema.foreign_keys[table.foreign_keys[1]];
-        const auto id1(
-            std::move(ConstructForeignKeyMatcher(schema, foreign_key1, row)));
-        const auto id2(
-            std::move(ConstructForeignKeyMatcher(schema, foreign_key2, row)));
-        if (IsForeignKeyMatcherWellDefined(id1.AsConstMap()) &&
-            IsForeignKeyMatcherWellDefined(id2.AsConstMap())) {
-          const auto &label1 =
-              GetTableName(schema.tables[foreign_key1.parent_table]);
-          const auto &label2 =
-              GetTableName(schema.tables[foreign_key2.parent_table]);
-          const auto &edge_type = GetTableName(table);
-          mg::Map properties(row.size());
-          for (size_t i = 0; i < row.size(); ++i) {
-            if (!utils::Contains(foreign_key1.child_columns, i) &&
-                !utils::Contains(foreign_key2.child_columns, i)) {
-              properties.InsertUnsafe(table.columns[i], row[i]);
-            }
-          }
-          CHECK(CreateRelationships(destination, label1, id1.AsConstMap(),
-                                    label2, id2.AsConstMap(), edge_type,
-                                    properties.AsConstMap()) == 1)
-              << "Unexpected number of relationships created!";
+    table_relationships.push_back(
+        GetTableRelationships(schema, table, &query_cache));
+    auto &relationships = table_relationships.back();
+    for (const auto &shape : relationships.shapes) {
+      lookup_indices.CreateLookupIndices(shape);
+    }
+    if (shard_map) {
+      for (const auto &foreign_keys : relationships.foreign_keys) {
+        for (const auto *foreign_key : foreign_keys) {
+          CheckShardableForeignKey(schema, *foreign_key, *shard_map);
         }
-      });
-    } else {
+      }
+    }
+    if (use_ghosts) {
+      for (const auto &shape : relationships.shapes) {
+        auto ghost_shape = shape;
+        ghost_shape.label2 = kGhostLabel + shape.label2;
+        ghost_shape.merge_end = true;
+        lookup_indices.CreateLookupIndices(ghost_shape);
+        relationships.ghost_queries.push_back(query_cache.Get(ghost_shape));
+      }
+    }
+  }
+  FreeDestinationMemory(pipelines);
+  ExecuteSchemaPlan(lookup_indices, destinations);
+
+  // Migrate edges using foreign keys.
+  DLOG(INFO) << "Migrating edges";
+  BeginRelationships(destinations);
+  size_t cross_shard = 0;
+  for (const auto &relationships : table_relationships) {
+    for (size_t i = 0; i < relationships.queries.size(); ++i) {
+      rows.Register(relationships.queries[i], relationships.shapes[i]);
+    }
+    // All of the destinations have the same number of lanes.
+    RelationshipRouter router(pipelines.front()->writer->lanes(),
+                              FLAGS_supernode_degree);
+    if (router.counts_degrees()) {
+      // Degrees are counted upfront, so that the lane of each relationship
+      // is known before any of them is written.
       source->ReadTable(
-          table, [&destination, &schema, &table](const auto &row) {
-            const auto &label1 = GetTableName(table);
-            mg::Map id1(row.size());
-            if (!table.primary_key.empty()) {
-              for (const auto pos : table.primary_key) {
-                id1.InsertUnsafe(table.columns[pos], row[pos]);
+          *relationships.table,
+          [&router, &relationships](std::vector<mg::Value> &&row) {
+            for (size_t i = 0; i < relationships.queries.size(); ++i) {
+              bool well_defined = true;
+              for (const auto *foreign_key : relationships.foreign_keys[i]) {
+                well_defined &= IsForeignKeyWellDefined(*foreign_key, row);
               }
-            } else {
-              // If there is no primary key, use all columns to match a node.
-              for (size_t i = 0; i < row.size(); ++i) {
-                id1.InsertUnsafe(table.columns[i], row[i]);
-              }
-            }
-            for (const auto &fk_pos : table.foreign_keys) {
-              const auto &foreign_key = schema.foreign_keys[fk_pos];
-              const auto id2(std::move(
-                  ConstructForeignKeyMatcher(schema, foreign_key, row)));
-              if (IsForeignKeyMatcherWellDefined(id2.AsConstMap())) {
-                const auto &label2 =
-                    GetTableName(schema.tables[foreign_key.parent_table]);
-                const std::string edge_type = label1 + "_to_" + label2;
-                // If there is no primary key, use `MERGE` instead of `CREATE`
-                // to prevent creating duplicate relationships.
-                const bool use_merge = table.primary_key.empty();
-                const auto rels_created = CreateRelationships(
-                    destination, label1, id1.AsConstMap(), label2,
-                    id2.AsConstMap(), edge_type,
-                    mg::Map(static_cast<size_t>(0)).AsConstMap(), use_merge);
-                if (!table.primary_key.empty()) {
-                  CHECK(rels_created == 1)
-                      << "Unexpected number of relationships created!";
-                }
+              if (well_defined) {
+                router.Count(*relationships.queries[i],
+                             BindRow(&row, relationships.plans[i]));
               }
             }
           });
     }
+    std::vector<std::vector<size_t>> start_positions;
+    std::vector<std::vector<size_t>> end_positions;
+    for (const auto *query : relationships.queries) {
+      start_positions.push_back(GetPositions(0, query->id1_size));
+      end_positions.push_back(GetPositions(query->id1_size, query->id2_size));
+    }
+    source->ReadTable(*relationships.table, [&rows, &router, &relationships,
+                                             &shard_map, &start_positions,
+                                             &end_positions, use_ghosts,
+                                             &cross_shard](
+                                                std::vector<mg::Value> &&row) {
+      for (size_t i = 0; i < relationships.queries.size(); ++i) {
+        bool well_defined = true;
+        for (const auto *foreign_key : relationships.foreign_keys[i]) {
+          well_defined &= IsForeignKeyWellDefined(*foreign_key, row);
+        }
+        if (!well_defined) {
+          continue;
+        }
+        const auto *query = relationships.queries[i];
+        auto values = BindRow(&row, relationships.plans[i]);
+        if (!shard_map) {
+          const auto lane = router.Route(*query, values);
+          rows.Add(query, std::move(values), lane);
+          continue;
+        }
+        const auto shard =
+            shard_map->GetShard(query->label1, values, start_positions[i]);
+        if (shard_map->GetShard(query->label2, values, end_positions[i]) !=
+            shard) {
+          ++cross_shard;
+          if (!use_ghosts) {
+            continue;
+          }
+          query = relationships.ghost_queries[i];
+        }
+        // Ghost rows are routed by the ghost key.
+        const auto lane = router.Route(*query, values);
+        rows.AddToShard(shard, query, std::move(values), lane);
+      }
+    });
+    // Send the remaining relationships of the table, so that buffered rows
+    // don't pile up across tables.
+    rows.Flush(GetTableName(*relationships.table) + " relationships");
   }
+  EndRelationships(destinations);
+  LogCrossShardRelationships(cross_shard);
 
   // Cleanup internally created indices.
-  for (const auto &table : schema.tables) {
-    if (!table.primary_key.empty()) {
-      DropLabelPropertyIndex(destination, GetTableName(table),
-                             table.columns[table.primary_key[0]]);
-    } else {
-      DropLabelIndex(destination, GetTableName(table));
-    }
-  }
+  ExecuteSchemaPlan(lookup_indices.DropIndices(), destinations);
+
+  VerifyCounts(verifier.get(), destinations);
 
   // Migrate constraints.
-  DLOG(INFO) << "Migrating existence constraints";
+  DLOG(INFO) << "Migrating constraints";
+  SchemaPlan constraints;
   for (const auto &constraint : schema.existence_constraints) {
     const auto &table = schema.tables[constraint.first];
     if (IsTableRelationship(table)) {
@@ -311,9 +1231,8 @@ void MigrateSqlDatabase(Source *source, MemgraphClient *destination) {
     }
     const auto &label = GetTableName(table);
     const auto &property = table.columns[constraint.second];
-    CreateExistenceConstraint(destination, label, property);
+    constraints.CreateExistenceConstraint(label, property);
   }
-  DLOG(INFO) << "Migrating unique constraints";
   for (const auto &constraint : schema.unique_constraints) {
     const auto &table = schema.tables[constraint.first];
     if (IsTableRelationship(table)) {
@@ -324,8 +1243,9 @@ void MigrateSqlDatabase(Source *source, MemgraphClient *destination) {
     for (const auto &column_pos : constraint.second) {
       properties.insert(table.columns[column_pos]);
     }
-    CreateUniqueConstraint(destination, label, properties);
+    constraints.CreateUniqueConstraint(label, properties);
   }
+  ExecuteSchemaPlan(constraints, destinations);
 }
 
 uint16_t GetSourcePort(int port, const std::string &kind) {
@@ -358,35 +1278,116 @@ int main(int argc, char **argv) {
       << "Please specify a valid server address and port for the source "
          "database.";
 
-  CHECK(!DoEndpointsMatch(FLAGS_source_host, source_port,
-                          FLAGS_destination_host, FLAGS_destination_port))
-      << "The source and destination endpoints match. Use two "
-         "different endpoints.";
+  const auto endpoints = GetDestinationEndpoints();
+  for (const auto &endpoint : endpoints) {
+    CHECK(IsDestinationOffline() ||
+          !DoEndpointsMatch(FLAGS_source_host, source_port, endpoint.host,
+                            endpoint.port))
+        << "The source and destination endpoints match. Use two "
+           "different endpoints.";
+  }
 
-  // Create a connection to the destination database.
-  auto destination_db = MemgraphClientConnection::Connect(
-      {.host = FLAGS_destination_host,
-       .port = static_cast<uint16_t>(FLAGS_destination_port),
-       .username = FLAGS_destination_username,
-       .password = FLAGS_destination_password,
-       .use_ssl = FLAGS_destination_use_ssl});
+  CHECK(FLAGS_batch_size > 0) << "Please specify a positive batch size.";
+  CHECK(FLAGS_transaction_batches > 0)
+      << "Please specify a positive number of batches per transaction.";
+  CHECK(FLAGS_transaction_bytes >= 0)
+      << "Please specify a non-negative transaction size in bytes.";
+  CHECK(FLAGS_destination_window >= 0)
+      << "Please specify a non-negative destination window.";
+  CHECK(FLAGS_destination_connections > 0)
+      << "Please specify a positive number of destination connections.";
+  CHECK(FLAGS_cleanup_chunk_size >= 0)
+      << "Please specify a non-negative cleanup chunk size.";
+  CHECK(FLAGS_destination_cypherl_statements > 0)
+      << "Please specify a positive number of statements per .cypherl file.";
+  CHECK(!IsDestinationOffline() || !FLAGS_memgraph_id_map)
+      << "Internal ids can't be mapped when writing to .cypherl files.";
+  CHECK(FLAGS_csv_staging_directory.empty() || !IsDestinationOffline())
+      << "CSV staging can't be used when writing to .cypherl files.";
+  CHECK(!FLAGS_bulk_load || !IsDestinationOffline())
+      << "Bulk load mode can't be used when writing to .cypherl files.";
+  CHECK(FLAGS_supernode_degree >= 0)
+      << "Please specify a non-negative supernode degree.";
+  CHECK(FLAGS_batch_latency_budget_ms > 0)
+      << "Please specify a positive batch latency budget.";
+  CHECK(FLAGS_destination_memory_budget > 0)
+      << "Please specify a positive destination memory budget.";
+  CHECK(FLAGS_destination_memory_threshold >= 0 &&
+        FLAGS_destination_memory_threshold <= 1)
+      << "Please specify a destination memory threshold between 0 and 1.";
+  CHECK(FLAGS_destination_memory_limit >= 0)
+      << "Please specify a non-negative destination memory limit.";
+  CHECK(FLAGS_destination_memory_poll_ms > 0)
+      << "Please specify a positive destination memory poll interval.";
+  CHECK(FLAGS_destination_memory_max_pause_s >= 0)
+      << "Please specify a non-negative maximum destination memory pause.";
+  CHECK(FLAGS_destination_memory_threshold == 0 || !IsDestinationOffline())
+      << "Destination memory can't be monitored when writing to .cypherl "
+         "files.";
+  CHECK(!FLAGS_verify_counts || !IsDestinationOffline())
+      << "Counts can't be verified when writing to .cypherl files.";
+  CHECK(endpoints.size() == 1 || !IsDestinationOffline())
+      << "Multiple destinations can't be used when writing to .cypherl "
+         "files.";
+  CHECK(endpoints.size() == 1 || FLAGS_csv_staging_directory.empty())
+      << "CSV staging can't be used with multiple destinations.";
+  CHECK(!FLAGS_shard_destinations || !FLAGS_memgraph_id_map)
+      << "Internal ids can't be mapped when writing to shards.";
+  CHECK(!FLAGS_shard_destinations || !FLAGS_verify_counts)
+      << "Counts can't be verified when writing to shards.";
+  CHECK(!FLAGS_shard_destinations || FLAGS_csv_staging_directory.empty())
+      << "CSV staging can't be used when writing to shards.";
+  CHECK(FLAGS_shard_destinations || FLAGS_shard_labels.empty())
+      << "Label shards can be set only when writing to shards.";
+  CHECK(FLAGS_cross_shard_relationships == "ghost" ||
+        FLAGS_cross_shard_relationships == "skip")
+      << "Please specify either 'ghost' or 'skip' for cross-shard "
+         "relationships.";
+  CHECK(FLAGS_source_page_size >= 0)
+      << "Please specify a non-negative source page size.";
+  CHECK(FLAGS_source_connections > 0)
+      << "Please specify a positive number of source connections.";
+  CHECK(FLAGS_csv_staging_rows > 0)
+      << "Please specify a positive number of rows per CSV file.";
+  CHECK(FLAGS_max_retries >= 0)
+      << "Please specify a non-negative number of retries.";
 
-  CHECK(destination_db)
-      << "Couldn't connect to the destination Memgraph database.";
+  // Create a connection to each of the destination databases.
+  std::vector<Destination> destinations;
+  destinations.reserve(endpoints.size());
+  for (const auto &endpoint : endpoints) {
+    auto destination_db = ConnectToDestination(endpoint);
+    CHECK(destination_db)
+        << "Couldn't connect to the destination Memgraph database.";
+    destinations.push_back({endpoint, std::move(destination_db), nullptr});
+  }
+
+  if (FLAGS_bulk_load) {
+    for (auto &destination : destinations) {
+      destination.bulk_load = std::make_unique<BulkLoadSession>(
+          destination.client.get(), [endpoint = destination.endpoint] {
+            return ConnectToDestination(endpoint);
+          });
+    }
+  }
 
   if (FLAGS_source_kind == "memgraph") {
-    // Create a connection to the source database.
-    auto source_db =
-        MemgraphClientConnection::Connect({.host = FLAGS_source_host,
-                                           .port = source_port,
-                                           .username = FLAGS_source_username,
-                                           .password = FLAGS_source_password,
-                                           .use_ssl = FLAGS_source_use_ssl});
+    // Create connections to the source database.
+    std::vector<std::unique_ptr<MemgraphClient>> source_dbs;
+    for (int i = 0; i < FLAGS_source_connections; ++i) {
+      auto source_db =
+          MemgraphClientConnection::Connect({.host = FLAGS_source_host,
+                                             .port = source_port,
+                                             .username = FLAGS_source_username,
+                                             .password = FLAGS_source_password,
+                                             .use_ssl = FLAGS_source_use_ssl});
 
-    CHECK(source_db) << "Couldn't connect to the source database.";
+      CHECK(source_db) << "Couldn't connect to the source database.";
+      source_dbs.push_back(std::move(source_db));
+    }
 
-    MemgraphSource source(std::move(source_db));
-    MigrateMemgraphDatabase(&source, destination_db.get());
+    MemgraphSource source(std::move(source_dbs), FLAGS_source_page_size);
+    MigrateMemgraphDatabase(&source, destinations);
   } else if (FLAGS_source_kind == "postgresql") {
     CHECK(FLAGS_source_database != "")
         << "Please specify a PostgreSQL database name!";
@@ -401,7 +1402,7 @@ int main(int argc, char **argv) {
     CHECK(source_db) << "Couldn't connect to the source database.";
 
     PostgresqlSource source(std::move(source_db));
-    MigrateSqlDatabase(&source, destination_db.get());
+    MigrateSqlDatabase(&source, destinations);
   } else if (FLAGS_source_kind == "mysql") {
     CHECK(FLAGS_source_database != "")
         << "Please specify a MySQL database name!";
@@ -414,12 +1415,23 @@ int main(int argc, char **argv) {
     CHECK(source_db) << "Couldn't connect to the source database.";
 
     MysqlSource source(std::move(source_db));
-    MigrateSqlDatabase(&source, destination_db.get());
+    MigrateSqlDatabase(&source, destinations);
   } else {
     std::cerr << "Unknown source kind '" << FLAGS_source_kind
               << "'. Please run 'mg_migrate --help' to see options.";
+    // Nothing was migrated, so the original storage mode is just restored.
+    for (auto &destination : destinations) {
+      destination.bulk_load.reset();
+    }
   }
 
+  for (auto &destination : destinations) {
+    if (destination.bulk_load) {
+      destination.bulk_load->Finish();
+      destination.bulk_load.reset();
+    }
+  }
+  destinations.clear();
   mg::Client::Finalize();
   return 0;
 }
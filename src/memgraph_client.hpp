@@ -20,6 +20,19 @@ class MemgraphClient {
   /// nothing to fetch. This method should be called as long as `std::nullopt`
   /// not returned after the execution.
   virtual std::optional<std::vector<mg::Value>> FetchOne() = 0;
+
+  /// Begins an explicit transaction. Statements executed afterwards are part
+  /// of the transaction until `Commit` or `Rollback` is called. Returns true on
+  /// success and false otherwise.
+  virtual bool Begin() = 0;
+
+  /// Commits the explicit transaction. Returns true on success and false
+  /// otherwise.
+  virtual bool Commit() = 0;
+
+  /// Rolls back the explicit transaction. Returns true on success and false
+  /// otherwise.
+  virtual bool Rollback() = 0;
 };
 
 /// A concrete implementation of MemgraphClient interface, that is a very thin
@@ -46,6 +59,12 @@ class MemgraphClientConnection : public MemgraphClient {
     return client_->FetchOne();
   }
 
+  bool Begin() override { return client_->BeginTransaction(); }
+
+  bool Commit() override { return client_->CommitTransaction(); }
+
+  bool Rollback() override { return client_->RollbackTransaction(); }
+
   /// Constructs a new client.
   static std::unique_ptr<MemgraphClient> Connect(
       const mg::Client::Params &params) {
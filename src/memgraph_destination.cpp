@@ -1,6 +1,5 @@
 #include "memgraph_destination.hpp"
 
-#include <map>
 #include <sstream>
 
 #include <glog/logging.h>
@@ -9,34 +8,10 @@
 
 namespace {
 
-const char *kParamPrefix = "param";
-
-/// A helper class for easier query parameter management.
-class ParamsBuilder {
- public:
-  /// Assign a new parameter name to the given `value` and returns '$'-prefixed
-  /// parameter name.
-  std::string Create(const mg::ConstValue &value) {
-    std::string key = kParamPrefix + std::to_string(counter_++);
-    auto [_, emplaced] = params_.emplace(key, mg::Value(value));
-    CHECK(emplaced) << "Param should be successfully inserted!";
-    return "$" + key;
-  }
-
-  /// Returns map of all assigned parameters. It should be called only once.
-  mg::Map GetParams() {
-    mg::Map map(params_.size());
-    for (auto &[key, value] : params_) {
-      map.InsertUnsafe(key, std::move(value));
-    }
-    params_.clear();
-    return map;
-  }
+const char *kBatchParam = "batch";
 
- private:
-  int counter_{0};
-  std::map<std::string, mg::Value> params_;
-};
+/// Conservative size estimate of values whose type isn't handled explicitly.
+const size_t kUnknownValueSize = 64;
 
 /// A helper function that escapes label, edge type and property names.
 std::string EscapeName(const std::string_view &src) {
@@ -54,79 +29,331 @@ std::string EscapeName(const std::string_view &src) {
   return out;
 }
 
-void WriteProperties(std::ostream *stream, ParamsBuilder *params,
-                     const mg::ConstMap &properties) {
+/// Writes a map literal which binds each of the `properties` to a consecutive
+/// value of the current batch row, starting at position `first`.
+void WriteBoundProperties(std::ostream *stream,
+                          const std::vector<std::string> &properties,
+                          size_t first) {
   *stream << "{";
-  utils::PrintIterable(
-      *stream, properties, ", ", [&params](auto &os, const auto &item) {
-        os << EscapeName(item.first) << ": " << params->Create(item.second);
-      });
+  utils::PrintIterable(*stream, properties, ", ",
+                       [&first](auto &os, const auto &property) {
+                         os << EscapeName(property) << ": row[" << first++
+                            << "]";
+                       });
   *stream << "}";
 }
 
-void WriteIdMatcher(std::ostream *stream, ParamsBuilder *params,
-                    const std::string &node,
-                    const mg::ConstMap &id_properties) {
+/// Writes a condition which matches the `node` by each of the `id_properties`
+/// against a consecutive value of the current batch row, starting at position
+/// `first`.
+void WriteBoundIdMatcher(std::ostream *stream, const std::string &node,
+                         const std::vector<std::string> &id_properties,
+                         size_t first) {
   utils::PrintIterable(*stream, id_properties, " AND ",
-                       [&params, &node](auto &os, const auto &item) {
-                         os << node << "." << EscapeName(item.first) << " = "
-                            << params->Create(item.second);
+                       [&node, &first](auto &os, const auto &property) {
+                         os << node << "." << EscapeName(property) << " = row["
+                            << first++ << "]";
                        });
 }
 
+/// Writes an expression which converts the value of the `column` of the
+/// current CSV row back to a value of the given `type`.
+void WriteCsvValue(std::ostream *stream, size_t column, CsvColumnType type) {
+  const auto field = "row.c" + std::to_string(column);
+  *stream << "CASE " << field << " WHEN '' THEN null ELSE ";
+  switch (type) {
+    case CsvColumnType::kNull:
+      *stream << "null";
+      break;
+    case CsvColumnType::kBool:
+      *stream << field << " = 'true'";
+      break;
+    case CsvColumnType::kInt:
+      *stream << "toInteger(" << field << ")";
+      break;
+    case CsvColumnType::kDouble:
+      *stream << "toFloat(" << field << ")";
+      break;
+    case CsvColumnType::kString:
+      *stream << "substring(" << field << ", 1)";
+      break;
+  }
+  *stream << " END";
+}
+
+/// Writes a map literal which binds each of the `properties` to a consecutive
+/// column of the current CSV row, starting at column `first`. Columns that
+/// hold only nulls are skipped.
+void WriteCsvProperties(std::ostream *stream,
+                        const std::vector<std::string> &properties,
+                        const std::vector<CsvColumnType> &types,
+                        size_t first) {
+  *stream << "{";
+  bool empty = true;
+  for (size_t i = 0; i < properties.size(); ++i) {
+    const auto column = first + i;
+    if (types[column] == CsvColumnType::kNull) {
+      continue;
+    }
+    *stream << (empty ? "" : ", ") << EscapeName(properties[i]) << ": ";
+    WriteCsvValue(stream, column, types[column]);
+    empty = false;
+  }
+  *stream << "}";
+}
+
+/// Writes a condition which matches the `node` by each of the
+/// `id_properties` against a consecutive column of the current CSV row,
+/// starting at column `first`.
+void WriteCsvIdMatcher(std::ostream *stream, const std::string &node,
+                       const std::vector<std::string> &id_properties,
+                       const std::vector<CsvColumnType> &types, size_t first) {
+  for (size_t i = 0; i < id_properties.size(); ++i) {
+    *stream << (i > 0 ? " AND " : "") << node << "."
+            << EscapeName(id_properties[i]) << " = ";
+    WriteCsvValue(stream, first + i, types[first + i]);
+  }
+}
+
+/// Writes the beginning of a LOAD CSV query which reads the file at the
+/// `server_path`.
+void WriteLoadCsv(std::ostream *stream, const std::string &server_path) {
+  *stream << "LOAD CSV FROM \"";
+  for (auto c : server_path) {
+    if (c == '"' || c == '\\') {
+      *stream << '\\';
+    }
+    *stream << c;
+  }
+  *stream << "\" WITH HEADER AS row ";
+}
+
 }  // namespace
 
-void CreateNode(MemgraphClient *client, const std::set<std::string> &labels,
-                const mg::ConstMap &properties) {
-  ParamsBuilder params;
+const CompiledQuery *QueryShapeCache::Get(const NodeShape &shape) {
+  auto it = nodes_.find(shape);
+  if (it != nodes_.end()) {
+    return &it->second;
+  }
+  // The row key, if any, precedes the property values.
+  const size_t first_property = shape.return_ids ? 1 : 0;
   std::ostringstream stream;
-  stream << "CREATE (u";
-  for (const auto &label : labels) {
+  stream << "UNWIND $" << kBatchParam << " AS row CREATE (u";
+  for (const auto &label : shape.labels) {
     stream << ":" << EscapeName(label);
   }
-  stream << " ";
-  WriteProperties(&stream, &params, properties);
-  stream << ");";
+  if (!shape.properties.empty()) {
+    stream << " ";
+    WriteBoundProperties(&stream, shape.properties, first_property);
+  }
+  stream << ")";
+  const size_t row_size = first_property + shape.properties.size() +
+                          (shape.property_map ? 1 : 0);
+  if (shape.property_map) {
+    stream << " SET u += row[" << row_size - 1 << "]";
+  }
+  if (shape.return_ids) {
+    stream << " RETURN row[0], id(u)";
+  }
+  stream << ";";
 
-  CHECK(client->Execute(stream.str(), params.GetParams().AsConstMap()))
-      << "Couldn't create a vertex!";
+  CompiledQuery query;
+  query.statement = stream.str();
+  query.row_size = row_size;
+  query.returns_ids = shape.return_ids;
+  query.labels.assign(shape.labels.begin(), shape.labels.end());
+  return &nodes_.emplace(shape, std::move(query)).first->second;
+}
+
+const CompiledQuery *QueryShapeCache::Get(const RelationshipShape &shape) {
+  auto it = relationships_.find(shape);
+  if (it != relationships_.end()) {
+    return &it->second;
+  }
+  const size_t id1_size = shape.match_ids ? 1 : shape.id1.size();
+  const size_t id2_size = shape.match_ids ? 1 : shape.id2.size();
+  // Batch rows are unwound together with their positions, so the number of
+  // created relationships can be reported for each row separately, unless
+  // they're counted only for the whole batch.
+  std::ostringstream stream;
+  if (shape.count_per_batch) {
+    stream << "UNWIND $" << kBatchParam << " AS row ";
+  } else {
+    stream << "UNWIND range(0, size($" << kBatchParam << ") - 1) AS i ";
+    stream << "WITH i, $" << kBatchParam << "[i] AS row ";
+  }
+  stream << "MATCH ";
+  if (shape.merge_end) {
+    CHECK(!shape.match_ids) << "Merged end nodes can't be matched by ids!";
+    stream << "(u:" << EscapeName(shape.label1) << ") WHERE ";
+    WriteBoundIdMatcher(&stream, "u", shape.id1, 0);
+    stream << " MERGE (v:" << EscapeName(shape.label2) << " ";
+    WriteBoundProperties(&stream, shape.id2, id1_size);
+    stream << ")";
+  } else if (shape.match_ids) {
+    stream << "(u), (v) WHERE id(u) = row[0] AND id(v) = row[1]";
+  } else {
+    stream << "(u:" << EscapeName(shape.label1) << "), ";
+    stream << "(v:" << EscapeName(shape.label2) << ")";
+    stream << " WHERE ";
+    WriteBoundIdMatcher(&stream, "u", shape.id1, 0);
+    stream << " AND ";
+    WriteBoundIdMatcher(&stream, "v", shape.id2, id1_size);
+  }
+  stream << (shape.use_merge ? " MERGE " : " CREATE ");
+  const size_t properties_size =
+      shape.property_map ? 1 : shape.properties.size();
+  if (shape.property_map) {
+    // Merged relationships are matched by their properties, which a map
+    // set after the merge doesn't do.
+    CHECK(!shape.use_merge) << "Merged relationships can't bind property maps!";
+    stream << "(u)-[e:" << EscapeName(shape.edge_type) << "]->(v)";
+    stream << " SET e = row[" << id1_size + id2_size << "]";
+  } else {
+    stream << "(u)-[:" << EscapeName(shape.edge_type);
+    if (!shape.properties.empty()) {
+      stream << " ";
+      WriteBoundProperties(&stream, shape.properties, id1_size + id2_size);
+    }
+    stream << "]->(v)";
+  }
+  stream << (shape.count_per_batch ? " RETURN COUNT(u);"
+                                   : " RETURN i, COUNT(u);");
+
+  CompiledQuery query;
+  query.statement = stream.str();
+  query.row_size = id1_size + id2_size + properties_size;
+  query.creates_relationships = true;
+  query.use_merge = shape.use_merge;
+  query.count_per_batch = shape.count_per_batch;
+  query.merge_end = shape.merge_end;
+  query.edge_type = shape.edge_type;
+  if (!shape.match_ids) {
+    query.label1 = shape.label1;
+    query.label2 = shape.label2;
+  }
+  query.id1_size = id1_size;
+  query.id2_size = id2_size;
+  return &relationships_.emplace(shape, std::move(query)).first->second;
+}
+
+mg::Map MakeBatchParams(mg::List rows) {
+  mg::Map params(1);
+  params.InsertUnsafe(kBatchParam, mg::Value(std::move(rows)));
+  return params;
+}
+
+bool CreateNodes(MemgraphClient *client, const CompiledQuery &query,
+                 const mg::ConstMap &params) {
+  if (!client->Execute(query.statement, params)) {
+    return false;
+  }
   CHECK(!client->FetchOne())
-      << "Unexpected data received while creating a vertex!";
+      << "Unexpected data received while creating vertices!";
+  return true;
+}
+
+std::optional<std::vector<std::pair<int64_t, int64_t>>> CreateNodesReturningIds(
+    MemgraphClient *client, const CompiledQuery &query,
+    const mg::ConstMap &params) {
+  CHECK(query.returns_ids) << "The query doesn't return node ids!";
+  if (!client->Execute(query.statement, params)) {
+    return std::nullopt;
+  }
+  std::vector<std::pair<int64_t, int64_t>> ids;
+  ids.reserve(params[kBatchParam].ValueList().size());
+  std::optional<std::vector<mg::Value>> result;
+  while ((result = client->FetchOne()) != std::nullopt) {
+    CHECK(result->size() == 2 && (*result)[0].type() == mg::Value::Type::Int &&
+          (*result)[1].type() == mg::Value::Type::Int)
+        << "Unexpected data received while creating vertices!";
+    ids.emplace_back((*result)[0].ValueInt(), (*result)[1].ValueInt());
+  }
+  return ids;
+}
+
+std::optional<std::vector<size_t>> CreateRelationships(
+    MemgraphClient *client, const CompiledQuery &query,
+    const mg::ConstMap &params) {
+  if (!client->Execute(query.statement, params)) {
+    return std::nullopt;
+  }
+  if (query.count_per_batch) {
+    const auto result = client->FetchOne();
+    CHECK(result && result->size() == 1 &&
+          (*result)[0].type() == mg::Value::Type::Int)
+        << "Unexpected data received while creating relationships!";
+    CHECK(!client->FetchOne())
+        << "Unexpected data received while creating relationships!";
+    return std::vector<size_t>{static_cast<size_t>((*result)[0].ValueInt())};
+  }
+  std::vector<size_t> created(params[kBatchParam].ValueList().size(), 0);
+  std::optional<std::vector<mg::Value>> result;
+  while ((result = client->FetchOne()) != std::nullopt) {
+    CHECK(result->size() == 2 && (*result)[0].type() == mg::Value::Type::Int &&
+          (*result)[1].type() == mg::Value::Type::Int)
+        << "Unexpected data received while creating relationships!";
+    const auto pos = (*result)[0].ValueInt();
+    CHECK(pos >= 0 && static_cast<size_t>(pos) < created.size())
+        << "Unexpected data received while creating relationships!";
+    created[pos] = static_cast<size_t>((*result)[1].ValueInt());
+  }
+  return created;
+}
+
+std::string GetLoadCsvNodesStatement(const NodeShape &shape,
+                                     const std::vector<CsvColumnType> &types,
+                                     const std::string &server_path) {
+  CHECK(!shape.return_ids && !shape.property_map)
+      << "Ids of loaded nodes can't be returned, nor property maps bound!";
+  CHECK(types.size() == shape.properties.size())
+      << "CSV staging file doesn't match the node shape!";
+  std::ostringstream stream;
+  WriteLoadCsv(&stream, server_path);
+  stream << "CREATE (u";
+  for (const auto &label : shape.labels) {
+    stream << ":" << EscapeName(label);
+  }
+  stream << " ";
+  WriteCsvProperties(&stream, shape.properties, types, 0);
+  stream << ") RETURN COUNT(*);";
+  return stream.str();
 }
 
-size_t CreateRelationships(MemgraphClient *client,
-                           const std::string_view &label1,
-                           const mg::ConstMap &id1,
-                           const std::string_view &label2,
-                           const mg::ConstMap &id2,
-                           const std::string_view &edge_type,
-                           const mg::ConstMap &properties, bool use_merge) {
-  ParamsBuilder params;
+std::string GetLoadCsvRelationshipsStatement(
+    const RelationshipShape &shape, const std::vector<CsvColumnType> &types,
+    const std::string &server_path) {
+  CHECK(!shape.match_ids && !shape.merge_end && !shape.property_map)
+      << "Loaded relationships can't be matched by ids, merge end nodes or "
+         "bind property maps!";
+  CHECK(types.size() ==
+        shape.id1.size() + shape.id2.size() + shape.properties.size())
+      << "CSV staging file doesn't match the relationship shape!";
   std::ostringstream stream;
+  WriteLoadCsv(&stream, server_path);
   stream << "MATCH ";
-  stream << "(u:" << EscapeName(label1) << "), ";
-  stream << "(v:" << EscapeName(label2) << ")";
+  stream << "(u:" << EscapeName(shape.label1) << "), ";
+  stream << "(v:" << EscapeName(shape.label2) << ")";
   stream << " WHERE ";
-  WriteIdMatcher(&stream, &params, "u", id1);
+  WriteCsvIdMatcher(&stream, "u", shape.id1, types, 0);
   stream << " AND ";
-  WriteIdMatcher(&stream, &params, "v", id2);
-  stream << (use_merge ? " MERGE " : " CREATE ");
-  stream << "(u)-[:" << EscapeName(edge_type);
-  if (!properties.empty()) {
-    stream << " ";
-    WriteProperties(&stream, &params, properties);
-  }
-  stream << "]->(v) RETURN COUNT(u);";
+  WriteCsvIdMatcher(&stream, "v", shape.id2, types, shape.id1.size());
+  stream << (shape.use_merge ? " MERGE " : " CREATE ");
+  stream << "(u)-[:" << EscapeName(shape.edge_type) << " ";
+  WriteCsvProperties(&stream, shape.properties, types,
+                     shape.id1.size() + shape.id2.size());
+  stream << "]->(v) RETURN COUNT(*);";
+  return stream.str();
+}
 
-  // Execute query and expect a single result returned.
-  CHECK(client->Execute(stream.str(), params.GetParams().AsConstMap()))
-      << "Couldn't create an edge!";
-  auto result = client->FetchOne();
-  CHECK(result) << "Couldn't create a relationship!";
+size_t LoadCsv(MemgraphClient *client, const std::string &statement) {
+  CHECK(client->Execute(statement)) << "Couldn't load data from CSV!";
+  const auto result = client->FetchOne();
+  CHECK(result && result->size() == 1 &&
+        (*result)[0].type() == mg::Value::Type::Int)
+      << "Unexpected data received while loading data from CSV!";
   CHECK(!client->FetchOne())
-      << "Unexpected data received while creating a relationship!";
-  CHECK(result->size() == 1 && (*result)[0].type() == mg::Value::Type::Int)
-      << "Unexpected data received while creating a relationship!";
+      << "Unexpected data received while loading data from CSV!";
   return static_cast<size_t>((*result)[0].ValueInt());
 }
 
@@ -205,17 +432,175 @@ void DropLabelPropertyIndex(MemgraphClient *client,
 }
 
 void RemoveLabelFromNodes(MemgraphClient *client,
-                          const std::string_view &label) {
-  const std::string query = "MATCH (u) REMOVE u:" + EscapeName(label) + ";";
-  CHECK(client->Execute(query)) << "Couldn't remove a label from nodes!";
+                          const std::string_view &label,
+                          const std::vector<std::string> &properties,
+                          size_t chunk_size) {
+  // Each chunk matches only nodes that still have the label, so the loop ends
+  // once a chunk removes fewer nodes than its limit.
+  std::ostringstream stream;
+  stream << "MATCH (u:" << EscapeName(label) << ") ";
+  if (chunk_size > 0) {
+    stream << "WITH u LIMIT " << chunk_size << " ";
+  }
+  stream << "REMOVE u:" << EscapeName(label);
+  for (const auto &property : properties) {
+    stream << ", u." << EscapeName(property);
+  }
+  if (chunk_size == 0) {
+    stream << ";";
+    CHECK(client->Execute(stream.str()))
+        << "Couldn't remove a label from nodes!";
+    CHECK(!client->FetchOne())
+        << "Unexpected data received while removing a label from nodes!";
+    return;
+  }
+  stream << " RETURN COUNT(u);";
+  const auto query = stream.str();
+
+  size_t total = 0;
+  while (true) {
+    CHECK(client->Execute(query)) << "Couldn't remove a label from nodes!";
+    const auto result = client->FetchOne();
+    CHECK(result && result->size() == 1 &&
+          (*result)[0].type() == mg::Value::Type::Int)
+        << "Unexpected data received while removing a label from nodes!";
+    const auto removed = static_cast<size_t>((*result)[0].ValueInt());
+    CHECK(!client->FetchOne())
+        << "Unexpected data received while removing a label from nodes!";
+    total += removed;
+    if (removed < chunk_size) {
+      break;
+    }
+    LOG(INFO) << "Removed label " << EscapeName(label) << " from " << total
+              << " nodes";
+  }
+  LOG(INFO) << "Removed label " << EscapeName(label) << " from " << total
+            << " nodes in total";
+}
+
+namespace {
+
+/// Executes the counting `statement` and returns its single integer result.
+size_t FetchCount(MemgraphClient *client, const std::string &statement) {
+  CHECK(client->Execute(statement)) << "Couldn't count migrated data!";
+  const auto result = client->FetchOne();
+  CHECK(result && result->size() == 1 &&
+        (*result)[0].type() == mg::Value::Type::Int)
+      << "Unexpected data received while counting migrated data!";
   CHECK(!client->FetchOne())
-      << "Unexpected data received while removing a label from nodes!";
+      << "Unexpected data received while counting migrated data!";
+  return static_cast<size_t>((*result)[0].ValueInt());
+}
+
+}  // namespace
+
+size_t CountNodes(MemgraphClient *client, const std::string_view &label) {
+  std::ostringstream stream;
+  stream << "MATCH (u";
+  if (!label.empty()) {
+    stream << ":" << EscapeName(label);
+  }
+  stream << ") RETURN COUNT(u);";
+  return FetchCount(client, stream.str());
 }
 
-void RemovePropertyFromNodes(MemgraphClient *client,
-                             const std::string_view &property) {
-  const std::string query = "MATCH (u) REMOVE u." + EscapeName(property) + ";";
-  CHECK(client->Execute(query)) << "Couldn't remove a property from nodes!";
+size_t CountRelationships(MemgraphClient *client,
+                          const std::string_view &edge_type) {
+  std::ostringstream stream;
+  stream << "MATCH ()-[e";
+  if (!edge_type.empty()) {
+    stream << ":" << EscapeName(edge_type);
+  }
+  stream << "]->() RETURN COUNT(e);";
+  return FetchCount(client, stream.str());
+}
+
+std::map<std::string, mg::Value> GetStorageInfo(MemgraphClient *client) {
+  CHECK(client->Execute("SHOW STORAGE INFO;"))
+      << "Couldn't get storage info!";
+  std::map<std::string, mg::Value> info;
+  std::optional<std::vector<mg::Value>> result;
+  while ((result = client->FetchOne()) != std::nullopt) {
+    CHECK(result->size() == 2 &&
+          (*result)[0].type() == mg::Value::Type::String)
+        << "Unexpected data received while getting storage info!";
+    info.emplace((*result)[0].ValueString(), std::move((*result)[1]));
+  }
+  return info;
+}
+
+std::string GetStorageMode(MemgraphClient *client) {
+  const auto info = GetStorageInfo(client);
+  auto it = info.find("storage_mode");
+  CHECK(it != info.end() && it->second.type() == mg::Value::Type::String)
+      << "Destination database didn't report its storage mode!";
+  return std::string(it->second.ValueString());
+}
+
+bool SetStorageMode(MemgraphClient *client, const std::string_view &mode) {
+  std::ostringstream stream;
+  stream << "STORAGE MODE " << mode << ";";
+  if (!client->Execute(stream.str())) {
+    return false;
+  }
+  while (client->FetchOne()) {
+  }
+  return true;
+}
+
+bool SetEdgeImportMode(MemgraphClient *client, bool active) {
+  if (!client->Execute(active ? "EDGE IMPORT MODE ACTIVE;"
+                              : "EDGE IMPORT MODE INACTIVE;")) {
+    return false;
+  }
+  while (client->FetchOne()) {
+  }
+  return true;
+}
+
+void FreeMemory(MemgraphClient *client) {
+  CHECK(client->Execute("FREE MEMORY;")) << "Couldn't free memory!";
   CHECK(!client->FetchOne())
-      << "Unexpected data received while removing a property from nodes!";
+      << "Unexpected data received while freeing memory!";
+}
+
+void CreateSnapshot(MemgraphClient *client) {
+  CHECK(client->Execute("CREATE SNAPSHOT;")) << "Couldn't create a snapshot!";
+  // The query returns the path of the created snapshot.
+  while (client->FetchOne()) {
+  }
+}
+
+size_t EstimateValueSize(const mg::ConstValue &value) {
+  switch (value.type()) {
+    case mg::Value::Type::Null:
+      return 1;
+    case mg::Value::Type::Bool:
+      return 1;
+    case mg::Value::Type::Int:
+    case mg::Value::Type::Double:
+      return 8;
+    case mg::Value::Type::String:
+      return value.ValueString().size();
+    case mg::Value::Type::List: {
+      size_t size = 0;
+      for (const auto &item : value.ValueList()) {
+        size += EstimateValueSize(item);
+      }
+      return size;
+    }
+    case mg::Value::Type::Map: {
+      size_t size = 0;
+      for (const auto &[key, item] : value.ValueMap()) {
+        size += key.size() + EstimateValueSize(item);
+      }
+      return size;
+    }
+    default:
+      // Temporal and spatial values take a few dozen bytes at most. Nodes,
+      // relationships and paths aren't written as parameters, so an unknown
+      // value shouldn't abort the migration only because its size is
+      // estimated.
+      return kUnknownValueSize;
+  }
 }
@@ -1,24 +1,167 @@
 #pragma once
 
+#include <map>
 #include <memory>
+#include <optional>
 #include <set>
 #include <string>
 #include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
 
+#include "csv_staging.hpp"
 #include "memgraph_client.hpp"
 
-void CreateNode(MemgraphClient *client, const std::set<std::string> &labels,
-                const mg::ConstMap &properties);
+/// Shape of nodes that can be created by the same query. If `return_ids` is
+/// set to true, each bound row starts with an integer key which isn't stored
+/// as a property. Instead, the query returns it together with the internal id
+/// of the node created for the row. If `property_map` is set to true, each
+/// bound row ends with a map of further properties, so all nodes with the same
+/// labels share the query regardless of their property names.
+struct NodeShape {
+  std::set<std::string> labels;
+  /// Property names, ordered as the values of bound rows.
+  std::vector<std::string> properties;
+  bool return_ids{false};
+  bool property_map{false};
+
+  bool operator<(const NodeShape &other) const {
+    return std::tie(labels, properties, return_ids, property_map) <
+           std::tie(other.labels, other.properties, other.return_ids,
+                    other.property_map);
+  }
+};
+
+/// Shape of relationships that can be created by the same query. The start
+/// node is matched by `label1` and properties `id1`, and the end node by
+/// `label2` and properties `id2`. If `match_ids` is set to true, the labels
+/// and id properties are ignored, and both nodes are matched by their internal
+/// ids instead. If `use_merge` is set to true, already existing relationships
+/// between nodes won't be created again. If `count_per_batch` is set to true,
+/// the query returns only the total number of relationships created for the
+/// whole batch, instead of a result row with the count for each row. If
+/// `merge_end` is set to true, the end node isn't matched but merged, e.g. as
+/// a ghost of a node stored by another shard. If `property_map` is set to
+/// true, `properties` are ignored, and each row holds a single map of
+/// properties instead, so all relationships of an edge type share the query.
+struct RelationshipShape {
+  std::string label1;
+  std::vector<std::string> id1;
+  std::string label2;
+  std::vector<std::string> id2;
+  std::string edge_type;
+  std::vector<std::string> properties;
+  bool match_ids{false};
+  bool use_merge{false};
+  bool count_per_batch{false};
+  bool merge_end{false};
+  bool property_map{false};
+
+  bool operator<(const RelationshipShape &other) const {
+    return std::tie(label1, id1, label2, id2, edge_type, properties, match_ids,
+                    use_merge, count_per_batch, merge_end, property_map) <
+           std::tie(other.label1, other.id1, other.label2, other.id2,
+                    other.edge_type, other.properties, other.match_ids,
+                    other.use_merge, other.count_per_batch, other.merge_end,
+                    other.property_map);
+  }
+};
+
+/// Statement compiled for a node or relationship shape. It takes a list of rows
+/// as a single parameter, where each row is a list of values. Node rows hold
+/// property values, while relationship rows hold `id1` values, followed by
+/// `id2` values and property values, all in the order given by the shape, or
+/// a single map of properties.
+/// Internal ids take place of the `id1` and `id2` values if the relationship
+/// endpoints are matched by internal ids.
+struct CompiledQuery {
+  std::string statement;
+  size_t row_size{0};
+  /// Whether the statement creates relationships and returns the number of
+  /// created relationships for each row, or for the whole batch if
+  /// `count_per_batch` is set.
+  bool creates_relationships{false};
+  bool use_merge{false};
+  bool count_per_batch{false};
+  /// Whether the end nodes are merged instead of matched.
+  bool merge_end{false};
+  /// Whether the statement creates nodes and returns their keys and internal
+  /// ids.
+  bool returns_ids{false};
+  /// Labels of the relationship endpoints, and the number of leading row
+  /// values that match each of them.
+  std::string label1;
+  size_t id1_size{0};
+  std::string label2;
+  size_t id2_size{0};
+  /// Labels of the created nodes, or the type of the created relationships.
+  std::vector<std::string> labels;
+  std::string edge_type;
+};
+
+/// Cache of statements compiled for each query shape, so that the statement
+/// text is built only once per shape. Returned pointers stay valid for the
+/// lifetime of the cache.
+class QueryShapeCache {
+ public:
+  const CompiledQuery *Get(const NodeShape &shape);
+
+  const CompiledQuery *Get(const RelationshipShape &shape);
+
+ private:
+  std::map<NodeShape, CompiledQuery> nodes_;
+  std::map<RelationshipShape, CompiledQuery> relationships_;
+};
+
+/// Returns parameters of a compiled query that binds the given `rows`.
+mg::Map MakeBatchParams(mg::List rows);
+
+// Creates a node for each row bound by the batch `params` using a single query
+// compiled for a node shape. Returns true on success and false otherwise, e.g.
+// if the query conflicts with another transaction.
+bool CreateNodes(MemgraphClient *client, const CompiledQuery &query,
+                 const mg::ConstMap &params);
+
+// Creates a node for each row bound by the batch `params` using a single query
+// compiled for a node shape with `return_ids` set. It returns the key of each
+// row together with the internal id of the node created for it, or
+// `std::nullopt` if the query failed.
+std::optional<std::vector<std::pair<int64_t, int64_t>>> CreateNodesReturningIds(
+    MemgraphClient *client, const CompiledQuery &query,
+    const mg::ConstMap &params);
 
 // Creates relationships between nodes that are matched by label and property
-// set (id). If `use_merge` is set to true, it won't create already existing
-// relationships between nodes. It returns a number of created/merged
-// relationships.
-size_t CreateRelationships(
-    MemgraphClient *client, const std::string_view &label1,
-    const mg::ConstMap &id1, const std::string_view &label2,
-    const mg::ConstMap &id2, const std::string_view &edge_type,
-    const mg::ConstMap &properties, bool use_merge = false);
+// set (id) for each row bound by the batch `params` using a single query
+// compiled for a relationship shape. It returns a number of created/merged
+// relationships for each row, or `std::nullopt` if the query failed. If the
+// query counts relationships per batch, a single total number is returned
+// instead.
+std::optional<std::vector<size_t>> CreateRelationships(
+    MemgraphClient *client, const CompiledQuery &query,
+    const mg::ConstMap &params);
+
+/// Returns a LOAD CSV query which creates a node of the given `shape` for
+/// each row of a staged CSV file with columns of the given `types`, and
+/// returns the number of created nodes. The file is read by the destination
+/// database from the `server_path`.
+std::string GetLoadCsvNodesStatement(const NodeShape &shape,
+                                     const std::vector<CsvColumnType> &types,
+                                     const std::string &server_path);
+
+/// Returns a LOAD CSV query which creates a relationship of the given `shape`
+/// for each row of a staged CSV file with columns of the given `types`, where
+/// rows are laid out as the rows of a compiled relationship query. The query
+/// returns the number of created or merged relationships, which is lower than
+/// the number of rows if any endpoint is missing. The file is read by the
+/// destination database from the `server_path`.
+std::string GetLoadCsvRelationshipsStatement(
+    const RelationshipShape &shape, const std::vector<CsvColumnType> &types,
+    const std::string &server_path);
+
+/// Executes a LOAD CSV `statement`, which loads a single file in a single
+/// transaction, and returns the number of nodes or relationships it reported.
+size_t LoadCsv(MemgraphClient *client, const std::string &statement);
 
 void CreateLabelIndex(MemgraphClient *client, const std::string_view &label);
 
@@ -40,8 +183,51 @@ void DropLabelPropertyIndex(MemgraphClient *client,
                             const std::string_view &label,
                             const std::string_view &property);
 
+/// Removes the `label` and the given `properties` from all nodes with the
+/// label. Nodes are processed in separate transactions of at most `chunk_size`
+/// nodes, so the destination keeps changes of a single chunk in memory instead
+/// of the whole graph. If `chunk_size` is 0, all nodes are processed in a
+/// single transaction. The label should be indexed, otherwise each chunk scans
+/// all of the nodes.
 void RemoveLabelFromNodes(MemgraphClient *client,
-                          const std::string_view &label);
+                          const std::string_view &label,
+                          const std::vector<std::string> &properties,
+                          size_t chunk_size);
+
+/// Returns the number of nodes with the given `label` in the destination
+/// database, or the number of all nodes if the label is empty.
+size_t CountNodes(MemgraphClient *client, const std::string_view &label);
+
+/// Returns the number of relationships of the given `edge_type` in the
+/// destination database, or the number of all relationships if the type is
+/// empty.
+size_t CountRelationships(MemgraphClient *client,
+                          const std::string_view &edge_type);
+
+/// Returns storage info of the destination database, which maps names of the
+/// storage metrics to their values.
+std::map<std::string, mg::Value> GetStorageInfo(MemgraphClient *client);
+
+/// Returns the storage mode of the destination database, e.g.
+/// `IN_MEMORY_TRANSACTIONAL`.
+std::string GetStorageMode(MemgraphClient *client);
+
+/// Switches the destination database to the given storage `mode`. Returns
+/// true on success and false otherwise, so that it can be used while
+/// recovering from another failure.
+bool SetStorageMode(MemgraphClient *client, const std::string_view &mode);
+
+/// Activates or deactivates the edge import mode of the on-disk storage.
+/// Returns true on success and false otherwise.
+bool SetEdgeImportMode(MemgraphClient *client, bool active);
+
+/// Asks the destination database to release the memory that isn't used
+/// anymore, e.g. by deleted objects and old deltas.
+void FreeMemory(MemgraphClient *client);
+
+void CreateSnapshot(MemgraphClient *client);
 
-void RemovePropertyFromNodes(MemgraphClient *client,
-                             const std::string_view &property);
+/// Returns an estimated size of the `value` in bytes, as sent to the
+/// destination. Values of other types than null, bool, int, double, string,
+/// list and map are estimated conservatively.
+size_t EstimateValueSize(const mg::ConstValue &value);
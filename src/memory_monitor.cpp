@@ -0,0 +1,178 @@
+#include "memory_monitor.hpp"
+
+#include <cctype>
+#include <map>
+#include <string>
+
+#include <glog/logging.h>
+
+#include "memgraph_destination.hpp"
+
+namespace {
+
+/// Interval between reports, and requests to free memory, while writes are
+/// paused.
+constexpr std::chrono::seconds kPausedReportInterval(10);
+
+/// Returns the first of the storage info `keys` whose value can be parsed as
+/// a number of bytes.
+std::optional<size_t> FindMemory(const std::map<std::string, mg::Value> &info,
+                                 std::initializer_list<const char *> keys) {
+  for (const auto *key : keys) {
+    auto it = info.find(key);
+    if (it != info.end()) {
+      if (auto bytes = ParseMemory(it->second)) {
+        return bytes;
+      }
+    }
+  }
+  return std::nullopt;
+}
+
+}  // namespace
+
+std::optional<size_t> ParseMemory(const mg::Value &value) {
+  if (value.type() == mg::Value::Type::Int) {
+    if (value.ValueInt() < 0) {
+      return std::nullopt;
+    }
+    return static_cast<size_t>(value.ValueInt());
+  }
+  if (value.type() != mg::Value::Type::String) {
+    return std::nullopt;
+  }
+  const std::string text(value.ValueString());
+  size_t unit_pos = 0;
+  double number = 0;
+  try {
+    number = std::stod(text, &unit_pos);
+  } catch (const std::exception &) {
+    return std::nullopt;
+  }
+  if (!(number >= 0)) {
+    return std::nullopt;
+  }
+  while (unit_pos < text.size() && std::isspace(text[unit_pos])) {
+    ++unit_pos;
+  }
+  const auto unit = text.substr(unit_pos);
+  double multiplier = 1;
+  if (unit.empty() || unit == "B") {
+    multiplier = 1;
+  } else if (unit == "KiB" || unit == "KB") {
+    multiplier = 1024.0;
+  } else if (unit == "MiB" || unit == "MB") {
+    multiplier = 1024.0 * 1024;
+  } else if (unit == "GiB" || unit == "GB") {
+    multiplier = 1024.0 * 1024 * 1024;
+  } else if (unit == "TiB" || unit == "TB") {
+    multiplier = 1024.0 * 1024 * 1024 * 1024;
+  } else {
+    return std::nullopt;
+  }
+  return static_cast<size_t>(number * multiplier);
+}
+
+MemoryMonitor::MemoryMonitor(std::unique_ptr<MemgraphClient> client,
+                             double threshold, size_t limit,
+                             std::chrono::milliseconds interval,
+                             std::chrono::seconds max_pause)
+    : client_(std::move(client)), interval_(interval), max_pause_(max_pause) {
+  CHECK(threshold > 0 && threshold <= 1)
+      << "Memory threshold should be a fraction between 0 and 1!";
+  if (limit == 0) {
+    const auto reported =
+        FindMemory(GetStorageInfo(client_.get()), {"memory_limit"});
+    CHECK(reported && *reported > 0)
+        << "Destination database didn't report its memory limit, please "
+           "specify it explicitly!";
+    limit = *reported;
+  }
+  threshold_bytes_ = static_cast<size_t>(limit * threshold);
+  LOG(INFO) << "Pausing writes while destination memory usage is above "
+            << threshold_bytes_ << " bytes";
+  thread_ = std::thread([this] { Run(); });
+}
+
+MemoryMonitor::~MemoryMonitor() {
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    stop_ = true;
+    paused_ = false;
+  }
+  stopped_.notify_all();
+  resumed_.notify_all();
+  thread_.join();
+}
+
+void MemoryMonitor::WaitForMemory() {
+  std::unique_lock<std::mutex> guard(lock_);
+  resumed_.wait(guard, [this] { return !paused_; });
+}
+
+void MemoryMonitor::FreeMemory() {
+  std::lock_guard<std::mutex> guard(client_lock_);
+  ::FreeMemory(client_.get());
+}
+
+std::optional<size_t> MemoryMonitor::GetMemoryUsage() {
+  std::lock_guard<std::mutex> guard(client_lock_);
+  return FindMemory(GetStorageInfo(client_.get()),
+                    {"memory_tracked", "memory_res", "memory_usage"});
+}
+
+void MemoryMonitor::Run() {
+  using Clock = std::chrono::steady_clock;
+  Clock::time_point paused_at;
+  Clock::time_point reported_at;
+  std::unique_lock<std::mutex> guard(lock_);
+  while (!stop_) {
+    guard.unlock();
+    const auto usage = GetMemoryUsage();
+    guard.lock();
+    if (!usage) {
+      LOG(WARNING) << "Destination database didn't report its memory usage, "
+                      "memory isn't monitored anymore!";
+      paused_ = false;
+      resumed_.notify_all();
+      return;
+    }
+    if (!paused_ && *usage > threshold_bytes_) {
+      LOG(WARNING) << "Destination memory usage is " << *usage
+                   << " bytes, pausing writes";
+      paused_ = true;
+      paused_at = reported_at = Clock::now();
+      guard.unlock();
+      FreeMemory();
+      guard.lock();
+    } else if (paused_ && *usage < threshold_bytes_ / 10 * 9) {
+      LOG(INFO) << "Destination memory usage is " << *usage
+                << " bytes, resuming writes";
+      paused_ = false;
+      resumed_.notify_all();
+    } else if (paused_) {
+      const auto now = Clock::now();
+      const auto paused_for =
+          std::chrono::duration_cast<std::chrono::seconds>(now - paused_at);
+      CHECK(max_pause_.count() == 0 || paused_for < max_pause_)
+          << "Destination memory usage stayed at " << *usage
+          << " bytes, above " << threshold_bytes_ / 10 * 9 << " bytes, for "
+          << paused_for.count()
+          << " seconds although the destination was asked to free memory. "
+             "The committed data probably doesn't fit below the threshold, "
+             "please raise --destination_memory_threshold or "
+             "--destination_memory_limit.";
+      if (now - reported_at >= kPausedReportInterval) {
+        LOG(WARNING) << "Writes are paused for " << paused_for.count()
+                     << " seconds, destination memory usage is " << *usage
+                     << " bytes, waiting for it to drop below "
+                     << threshold_bytes_ / 10 * 9 << " bytes";
+        reported_at = now;
+        guard.unlock();
+        FreeMemory();
+        guard.lock();
+      }
+    }
+    stopped_.wait_for(guard, interval_, [this] { return stop_; });
+  }
+}
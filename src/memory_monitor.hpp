@@ -0,0 +1,67 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+#include "memgraph_client.hpp"
+
+/// Returns the number of bytes given by the storage info `value`. Depending on
+/// the Memgraph version, it's either an integer number of bytes, or a string
+/// such as "1.50GiB".
+std::optional<size_t> ParseMemory(const mg::Value &value);
+
+/// Polls memory usage of the destination database through its own connection,
+/// and pauses the submission of batches while the usage is above the
+/// threshold. Once the usage crosses the threshold, the destination is asked
+/// to free memory, and batches are submitted again only after the usage drops
+/// below 90% of the threshold, so that the writers don't flap around it.
+///
+/// If committed data alone keeps the usage above that level, freeing memory
+/// can't help, so the monitor aborts the migration once writes stay paused for
+/// longer than the maximum pause, instead of blocking the writers forever.
+class MemoryMonitor {
+ public:
+  /// Creates a monitor which polls memory usage every `interval`. The
+  /// threshold is the `threshold` fraction of the memory `limit` in bytes, or
+  /// of the limit reported by the destination if the `limit` is 0. Writes are
+  /// paused for at most `max_pause`, or indefinitely if it's 0.
+  MemoryMonitor(std::unique_ptr<MemgraphClient> client, double threshold,
+                size_t limit, std::chrono::milliseconds interval,
+                std::chrono::seconds max_pause);
+
+  MemoryMonitor(const MemoryMonitor &) = delete;
+  MemoryMonitor(MemoryMonitor &&) = delete;
+  MemoryMonitor &operator=(const MemoryMonitor &) = delete;
+  MemoryMonitor &operator=(MemoryMonitor &&) = delete;
+
+  ~MemoryMonitor();
+
+  /// Blocks while the submission of batches is paused.
+  void WaitForMemory();
+
+  /// Asks the destination to free memory, e.g. between migration phases.
+  void FreeMemory();
+
+ private:
+  /// Returns memory usage of the destination in bytes.
+  std::optional<size_t> GetMemoryUsage();
+
+  void Run();
+
+  std::mutex client_lock_;
+  std::unique_ptr<MemgraphClient> client_;
+  size_t threshold_bytes_;
+  std::chrono::milliseconds interval_;
+  std::chrono::seconds max_pause_;
+
+  std::mutex lock_;
+  std::condition_variable resumed_;
+  std::condition_variable stopped_;
+  bool paused_{false};
+  bool stop_{false};
+  std::thread thread_;
+};
@@ -0,0 +1,35 @@
+#include "row_binding.hpp"
+
+#include <set>
+
+#include <glog/logging.h>
+
+std::vector<std::vector<BindingStep>> PlanBindings(
+    const std::vector<std::vector<size_t>> &positions) {
+  std::vector<std::vector<BindingStep>> plans(positions.size());
+  std::set<size_t> used;
+  for (size_t i = positions.size(); i-- > 0;) {
+    plans[i].resize(positions[i].size());
+    for (size_t j = positions[i].size(); j-- > 0;) {
+      const auto pos = positions[i][j];
+      plans[i][j] = {pos, used.insert(pos).second};
+    }
+  }
+  return plans;
+}
+
+mg::List BindRow(std::vector<mg::Value> *row,
+                 const std::vector<BindingStep> &plan) {
+  mg::List values(plan.size());
+  for (const auto &step : plan) {
+    CHECK(step.position < row->size())
+        << "Couldn't access result for the given column (index out of bounds)!";
+    auto &value = (*row)[step.position];
+    if (step.move) {
+      values.Append(std::move(value));
+    } else {
+      values.Append(value);
+    }
+  }
+  return values;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <vector>
+
+#include <mgclient-value.hpp>
+
+/// A single step of binding a result row to a row of a compiled query.
+struct BindingStep {
+  size_t position;
+  /// Whether the value is moved out of the result row instead of copied.
+  bool move;
+};
+
+/// Plans bindings of a result row to a row of each of the compiled queries,
+/// given the result `positions` bound by each query. Rows are bound in the
+/// given order, and each value is moved out of the result row on its last
+/// use, so that it's copied only if it's bound more than once.
+std::vector<std::vector<BindingStep>> PlanBindings(
+    const std::vector<std::vector<size_t>> &positions);
+
+/// Binds values of the result `row` to a row of a compiled query by following
+/// the given `plan`. Values moved by the plan can't be used afterwards.
+mg::List BindRow(std::vector<mg::Value> *row,
+                 const std::vector<BindingStep> &plan);
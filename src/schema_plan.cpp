@@ -0,0 +1,115 @@
+#include "schema_plan.hpp"
+
+#include <atomic>
+#include <thread>
+
+#include <glog/logging.h>
+
+void SchemaPlan::CreateLabelIndex(const std::string_view &label) {
+  std::string name(label);
+  if (Add("CREATE INDEX " + name,
+          [name](auto *client) { ::CreateLabelIndex(client, name); })) {
+    indices_.emplace_back(name, "");
+  }
+}
+
+void SchemaPlan::CreateLabelPropertyIndex(const std::string_view &label,
+                                          const std::string_view &property) {
+  std::string label_name(label), property_name(property);
+  if (Add("CREATE INDEX " + label_name + "." + property_name,
+          [label_name, property_name](auto *client) {
+            ::CreateLabelPropertyIndex(client, label_name, property_name);
+          })) {
+    indices_.emplace_back(label_name, property_name);
+  }
+}
+
+void SchemaPlan::DropLabelIndex(const std::string_view &label) {
+  std::string name(label);
+  Add("DROP INDEX " + name,
+      [name](auto *client) { ::DropLabelIndex(client, name); });
+}
+
+void SchemaPlan::DropLabelPropertyIndex(const std::string_view &label,
+                                        const std::string_view &property) {
+  std::string label_name(label), property_name(property);
+  Add("DROP INDEX " + label_name + "." + property_name,
+      [label_name, property_name](auto *client) {
+        ::DropLabelPropertyIndex(client, label_name, property_name);
+      });
+}
+
+void SchemaPlan::CreateExistenceConstraint(const std::string_view &label,
+                                           const std::string_view &property) {
+  std::string label_name(label), property_name(property);
+  Add("EXISTS " + label_name + "." + property_name,
+      [label_name, property_name](auto *client) {
+        ::CreateExistenceConstraint(client, label_name, property_name);
+      });
+}
+
+void SchemaPlan::CreateUniqueConstraint(
+    const std::string_view &label, const std::set<std::string> &properties) {
+  std::string label_name(label);
+  std::string key = "UNIQUE " + label_name;
+  for (const auto &property : properties) {
+    key += "." + property;
+  }
+  Add(std::move(key), [label_name, properties](auto *client) {
+    ::CreateUniqueConstraint(client, label_name, properties);
+  });
+}
+
+void SchemaPlan::CreateLookupIndices(const RelationshipShape &shape) {
+  CHECK(!shape.match_ids) << "Relationships matched by ids don't need "
+                             "lookup indices!";
+  if (shape.id1.empty()) {
+    CreateLabelIndex(shape.label1);
+  } else {
+    CreateLabelPropertyIndex(shape.label1, shape.id1.front());
+  }
+  if (shape.id2.empty()) {
+    CreateLabelIndex(shape.label2);
+  } else {
+    CreateLabelPropertyIndex(shape.label2, shape.id2.front());
+  }
+}
+
+SchemaPlan SchemaPlan::DropIndices() const {
+  SchemaPlan plan;
+  for (const auto &[label, property] : indices_) {
+    if (property.empty()) {
+      plan.DropLabelIndex(label);
+    } else {
+      plan.DropLabelPropertyIndex(label, property);
+    }
+  }
+  return plan;
+}
+
+void SchemaPlan::Execute(
+    const std::vector<MemgraphClient *> &clients) const {
+  CHECK(!clients.empty()) << "Schema plan needs at least one connection!";
+  std::atomic<size_t> next{0};
+  const auto run = [this, &next](MemgraphClient *client) {
+    for (size_t i = next++; i < changes_.size(); i = next++) {
+      changes_[i](client);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < clients.size() && i < changes_.size(); ++i) {
+    threads.emplace_back(run, clients[i]);
+  }
+  run(clients[0]);
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+bool SchemaPlan::Add(std::string key, Change change) {
+  if (!keys_.insert(std::move(key)).second) {
+    return false;
+  }
+  changes_.push_back(std::move(change));
+  return true;
+}
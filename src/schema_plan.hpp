@@ -0,0 +1,61 @@
+#pragma once
+
+#include <functional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "memgraph_client.hpp"
+#include "memgraph_destination.hpp"
+
+/// Plan of index and constraint changes in the destination database. Changes
+/// in the plan don't depend on each other, so they're executed concurrently
+/// over multiple connections. The same change is planned only once.
+class SchemaPlan {
+ public:
+  void CreateLabelIndex(const std::string_view &label);
+
+  void CreateLabelPropertyIndex(const std::string_view &label,
+                                const std::string_view &property);
+
+  void DropLabelIndex(const std::string_view &label);
+
+  void DropLabelPropertyIndex(const std::string_view &label,
+                              const std::string_view &property);
+
+  void CreateExistenceConstraint(const std::string_view &label,
+                                 const std::string_view &property);
+
+  void CreateUniqueConstraint(const std::string_view &label,
+                              const std::set<std::string> &properties);
+
+  /// Plans creation of indices that let relationships of the given `shape`
+  /// match their endpoints, i.e. an index on the label and the first id
+  /// property of each endpoint.
+  void CreateLookupIndices(const RelationshipShape &shape);
+
+  /// Plans the inverse of each index created by this plan.
+  SchemaPlan DropIndices() const;
+
+  /// Executes the planned changes using the given `clients` concurrently. It
+  /// aborts if any of the changes fails. The same plan can be executed again,
+  /// e.g. on another destination.
+  void Execute(const std::vector<MemgraphClient *> &clients) const;
+
+  size_t size() const { return changes_.size(); }
+
+ private:
+  using Change = std::function<void(MemgraphClient *)>;
+
+  /// Adds the `change` unless a change with the same `key` is already
+  /// planned. Returns whether the change was added.
+  bool Add(std::string key, Change change);
+
+  std::set<std::string> keys_;
+  std::vector<Change> changes_;
+  /// Indices created by the plan, as (label, property) pairs, where the
+  /// property is empty for label indices.
+  std::vector<std::pair<std::string, std::string>> indices_;
+};
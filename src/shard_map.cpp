@@ -0,0 +1,125 @@
+#include "shard_map.hpp"
+
+#include <sstream>
+
+#include <glog/logging.h>
+
+namespace {
+
+const uint64_t kFnvOffset = 14695981039346656037ULL;
+const uint64_t kFnvPrime = 1099511628211ULL;
+
+/// Returns the FNV-1a hash of the `size` bytes at `data`, continuing from the
+/// given `hash`. Unlike `std::hash`, it's the same in every build.
+uint64_t HashBytes(const void *data, size_t size, uint64_t hash = kFnvOffset) {
+  const auto *bytes = static_cast<const unsigned char *>(data);
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ bytes[i]) * kFnvPrime;
+  }
+  return hash;
+}
+
+/// Returns a stable hash of a key `value`. Integers are hashed by their
+/// value, so that the key of a node has the same hash whether it's read from
+/// a row or given as an id.
+uint64_t HashValue(const mg::ConstValue &value) {
+  const auto type = static_cast<unsigned char>(value.type());
+  auto hash = HashBytes(&type, sizeof(type));
+  switch (value.type()) {
+    case mg::Value::Type::Bool: {
+      const bool boolean = value.ValueBool();
+      return HashBytes(&boolean, sizeof(boolean), hash);
+    }
+    case mg::Value::Type::Int: {
+      const auto integer = value.ValueInt();
+      return HashBytes(&integer, sizeof(integer), hash);
+    }
+    case mg::Value::Type::Double: {
+      const auto number = value.ValueDouble();
+      return HashBytes(&number, sizeof(number), hash);
+    }
+    case mg::Value::Type::String: {
+      const auto text = value.ValueString();
+      return HashBytes(text.data(), text.size(), hash);
+    }
+    default:
+      // Other types aren't used as keys, so they're hashed by type only.
+      return hash;
+  }
+}
+
+/// Mixes the bits of the `hash`, so that sums of value hashes are spread
+/// evenly across shards.
+uint64_t Mix(uint64_t hash) {
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+}  // namespace
+
+ShardMap::ShardMap(size_t shards, std::map<std::string, size_t> label_shards)
+    : shards_(shards), label_shards_(label_shards.begin(), label_shards.end()) {
+  CHECK(shards_ > 0) << "Number of shards should be a positive number!";
+  for (const auto &[label, shard] : label_shards_) {
+    CHECK(shard < shards_) << "Label " << label << " is mapped to shard "
+                           << shard << ", but there are only " << shards_
+                           << " shards!";
+  }
+}
+
+std::optional<size_t> ShardMap::GetLabelShard(
+    const std::string_view &label) const {
+  auto it = label_shards_.find(label);
+  if (it == label_shards_.end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+size_t ShardMap::GetShard(const std::string_view &label, const mg::List &row,
+                          const std::vector<size_t> &positions) const {
+  if (auto shard = GetLabelShard(label)) {
+    return *shard;
+  }
+  // Value hashes are summed, so the order of key values doesn't matter.
+  uint64_t hash = HashBytes(label.data(), label.size());
+  for (const auto position : positions) {
+    CHECK(position < row.size()) << "Key position out of bounds!";
+    hash += HashValue(row[position]);
+  }
+  return Mix(hash) % shards_;
+}
+
+size_t ShardMap::GetShard(const std::string_view &label, int64_t id) const {
+  if (auto shard = GetLabelShard(label)) {
+    return *shard;
+  }
+  const mg::Value value(id);
+  return Mix(HashBytes(label.data(), label.size()) +
+             HashValue(value.AsConstValue())) %
+         shards_;
+}
+
+std::map<std::string, size_t> ParseLabelShards(const std::string &text) {
+  std::map<std::string, size_t> label_shards;
+  std::istringstream stream(text);
+  std::string pair;
+  while (std::getline(stream, pair, ',')) {
+    const auto equals = pair.rfind('=');
+    size_t shard = 0;
+    size_t parsed = 0;
+    if (equals != std::string::npos && equals > 0) {
+      try {
+        shard = std::stoul(pair.substr(equals + 1), &parsed);
+      } catch (const std::exception &) {
+      }
+    }
+    CHECK(parsed > 0 && equals + 1 + parsed == pair.size())
+        << "Please specify label shards as label=shard, got '" << pair
+        << "'.";
+    label_shards[pair.substr(0, equals)] = shard;
+  }
+  return label_shards;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <mgclient-value.hpp>
+
+/// Policy for relationships whose endpoints are assigned to different shards.
+/// Each relationship is written to the shard of its start node. With
+/// `kGhost`, its end node is represented there by a ghost node, which holds
+/// only the key of the node and is merged on the first use. With `kSkip`, the
+/// relationship isn't written at all.
+enum class CrossShardPolicy { kGhost, kSkip };
+
+/// Assigns nodes to shards, i.e. destination instances that store parts of
+/// the graph. A node is assigned by its label if the label is mapped to a
+/// shard, and by a hash of its key otherwise. Keys are hashed by a stable
+/// hash, which doesn't depend on the order of the key values, so a node is
+/// assigned to the same shard in every run, and relationships can list the
+/// key values of their endpoints in any order.
+class ShardMap {
+ public:
+  ShardMap(size_t shards, std::map<std::string, size_t> label_shards);
+
+  size_t shards() const { return shards_; }
+
+  bool has_label_shards() const { return !label_shards_.empty(); }
+
+  /// Returns the shard mapped to the `label`, if any.
+  std::optional<size_t> GetLabelShard(const std::string_view &label) const;
+
+  /// Returns the shard of a node with the given `label`, whose key consists
+  /// of the `row` values at the given `positions`.
+  size_t GetShard(const std::string_view &label, const mg::List &row,
+                  const std::vector<size_t> &positions) const;
+
+  /// Returns the shard of a node with the given `label`, whose key is the
+  /// integer `id`.
+  size_t GetShard(const std::string_view &label, int64_t id) const;
+
+ private:
+  size_t shards_;
+  std::map<std::string, size_t, std::less<>> label_shards_;
+};
+
+/// Parses a map of labels to shards given as comma-separated `label=shard`
+/// pairs. It aborts if the `text` isn't well formed.
+std::map<std::string, size_t> ParseLabelShards(const std::string &text);
@@ -1,33 +1,195 @@
 #include "source/memgraph.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+
 #include <glog/logging.h>
 
-MemgraphSource::MemgraphSource(std::unique_ptr<MemgraphClient> client)
-    : client_(std::move(client)) {}
+#include "utils/bounded_queue.hpp"
+
+namespace {
+
+/// Maximum number of times a single page is read before giving up.
+const size_t kMaxPageAttempts = 3;
+
+}  // namespace
+
+MemgraphSource::MemgraphSource(std::unique_ptr<MemgraphClient> client,
+                               size_t page_size)
+    : client_(client.get()), page_size_(page_size) {
+  clients_.push_back(std::move(client));
+}
+
+MemgraphSource::MemgraphSource(
+    std::vector<std::unique_ptr<MemgraphClient>> clients, size_t page_size)
+    : clients_(std::move(clients)), page_size_(page_size) {
+  CHECK(!clients_.empty()) << "Memgraph source needs at least one connection!";
+  client_ = clients_.front().get();
+}
 
 MemgraphSource::~MemgraphSource() {}
 
-void MemgraphSource::ReadNodes(
-    std::function<void(const mg::ConstNode &node)> callback) {
-  CHECK(client_->Execute("MATCH (u) RETURN u;")) << "Can't read vertices!";
-  std::optional<std::vector<mg::Value>> row;
-  while ((row = client_->FetchOne()) != std::nullopt) {
-    CHECK(row->size() == 1 && (*row)[0].type() == mg::Value::Type::Node)
+void MemgraphSource::ReadNodes(std::function<void(const Node &node)> callback) {
+  // Nodes are grouped by their label sets on the client, so that the nodes
+  // are scanned only once, regardless of the number of label sets.
+  std::vector<std::string> labels;
+  const auto read = [&callback, &labels](const std::vector<mg::Value> &row) {
+    CHECK(row.size() == 3 && row[0].type() == mg::Value::Type::List &&
+          row[1].type() == mg::Value::Type::Int &&
+          row[2].type() == mg::Value::Type::Map)
         << "Received unexpected result while reading vertices!";
-    callback((*row)[0].ValueNode());
+    labels.clear();
+    for (const auto &label : row[0].ValueList()) {
+      CHECK(label.type() == mg::Value::Type::String)
+          << "Received unexpected result while reading vertices!";
+      labels.emplace_back(label.ValueString());
+    }
+    callback({labels, row[1].ValueInt(), row[2].ValueMap()});
+  };
+  if (page_size_ == 0 && clients_.size() == 1) {
+    Read("MATCH (u) RETURN labels(u), id(u), properties(u);", "vertices",
+         read);
+  } else {
+    ReadPages("MATCH (u) RETURN min(id(u)), max(id(u));",
+              "MATCH (u) WHERE id(u) >= $lo AND id(u) < $hi "
+              "RETURN labels(u), id(u), properties(u);",
+              "vertices", read);
   }
 }
 
 void MemgraphSource::ReadRelationships(
-    std::function<void(const mg::ConstRelationship &rel)> callback) {
-  CHECK(client_->Execute("MATCH (u)-[e]->(v) RETURN e;"))
-      << "Can't read edges!";
+    std::function<void(const Relationship &rel)> callback) {
+  // Relationships are grouped by their edge types on the client, so that
+  // each page expands the relationships only once, regardless of the number
+  // of edge types.
+  std::string type;
+  const auto read = [&callback, &type](const std::vector<mg::Value> &row) {
+    CHECK(row.size() == 4 && row[0].type() == mg::Value::Type::String &&
+          row[1].type() == mg::Value::Type::Int &&
+          row[2].type() == mg::Value::Type::Int &&
+          row[3].type() == mg::Value::Type::Map)
+        << "Received unexpected result while reading edges!";
+    type = row[0].ValueString();
+    callback({type, row[1].ValueInt(), row[2].ValueInt(), row[3].ValueMap()});
+  };
+  if (page_size_ == 0 && clients_.size() == 1) {
+    Read("MATCH (u)-[e]->(v) RETURN type(e), id(u), id(v), properties(e);",
+         "edges", read);
+  } else {
+    ReadPages("MATCH ()-[e]->() RETURN min(id(e)), max(id(e));",
+              "MATCH (u)-[e]->(v) WHERE id(e) >= $lo AND id(e) < $hi "
+              "RETURN type(e), id(u), id(v), properties(e);",
+              "edges", read);
+  }
+}
+
+void MemgraphSource::Read(const std::string &statement,
+                          const std::string &kind,
+                          const RowCallback &callback) {
+  CHECK(client_->Execute(statement)) << "Can't read " << kind << "!";
   std::optional<std::vector<mg::Value>> row;
   while ((row = client_->FetchOne()) != std::nullopt) {
-    CHECK(row->size() == 1 && (*row)[0].type() == mg::Value::Type::Relationship)
-        << "Received unexpected result while reading edges!";
-    callback((*row)[0].ValueRelationship());
+    callback(*row);
+  }
+}
+
+void MemgraphSource::ReadPages(const std::string &bounds_statement,
+                               const std::string &statement,
+                               const std::string &kind,
+                               const RowCallback &callback) {
+  CHECK(client_->Execute(bounds_statement)) << "Can't read " << kind << "!";
+  const auto bounds = client_->FetchOne();
+  CHECK(bounds && bounds->size() == 2)
+      << "Received unexpected result while reading " << kind << "!";
+  CHECK(!client_->FetchOne())
+      << "Received unexpected result while reading " << kind << "!";
+  if ((*bounds)[0].type() == mg::Value::Type::Null) {
+    // There's nothing to read.
+    return;
+  }
+  CHECK((*bounds)[0].type() == mg::Value::Type::Int &&
+        (*bounds)[1].type() == mg::Value::Type::Int)
+      << "Received unexpected result while reading " << kind << "!";
+  const auto min_id = (*bounds)[0].ValueInt();
+  const auto max_id = (*bounds)[1].ValueInt();
+  const auto page_size =
+      page_size_ > 0
+          ? static_cast<int64_t>(page_size_)
+          : (max_id - min_id) / static_cast<int64_t>(clients_.size()) + 1;
+
+  if (clients_.size() == 1) {
+    Page page;
+    for (auto lo = min_id; lo <= max_id; lo += page_size) {
+      ReadPage(client_, statement, kind, lo, lo + page_size, &page);
+      for (const auto &row : page) {
+        callback(row);
+      }
+    }
+    return;
+  }
+
+  // Each reader takes the next page that isn't read yet, and passes it on
+  // through the queue, which is closed once the last reader is done.
+  utils::BoundedQueue<Page> pages(2 * clients_.size());
+  std::atomic<int64_t> next_lo{min_id};
+  std::atomic<size_t> active_readers{clients_.size()};
+  std::vector<std::thread> readers;
+  readers.reserve(clients_.size());
+  for (auto &client : clients_) {
+    readers.emplace_back([&, client = client.get()] {
+      for (auto lo = next_lo.fetch_add(page_size); lo <= max_id;
+           lo = next_lo.fetch_add(page_size)) {
+        Page page;
+        ReadPage(client, statement, kind, lo, lo + page_size, &page);
+        if (!pages.Push(std::move(page))) {
+          break;
+        }
+      }
+      if (--active_readers == 0) {
+        pages.Close();
+      }
+    });
+  }
+  std::optional<Page> page;
+  while ((page = pages.Pop()) != std::nullopt) {
+    for (const auto &row : *page) {
+      callback(row);
+    }
+  }
+  for (auto &reader : readers) {
+    reader.join();
+  }
+}
+
+void MemgraphSource::ReadPage(MemgraphClient *client,
+                              const std::string &statement,
+                              const std::string &kind, int64_t lo, int64_t hi,
+                              Page *page) {
+  mg::Map params(2);
+  params.Insert("lo", mg::Value(lo));
+  params.Insert("hi", mg::Value(hi));
+  for (size_t attempt = 1;; ++attempt) {
+    page->clear();
+    try {
+      if (client->Execute(statement, params.AsConstMap())) {
+        std::optional<std::vector<mg::Value>> row;
+        while ((row = client->FetchOne()) != std::nullopt) {
+          page->push_back(std::move(*row));
+        }
+        break;
+      }
+    } catch (const std::exception &e) {
+      LOG(WARNING) << e.what();
+    }
+    CHECK(attempt < kMaxPageAttempts) << "Can't read " << kind
+                                      << " with ids from " << lo << " to "
+                                      << hi << "!";
+    LOG(WARNING) << "Reading " << kind << " with ids from " << lo << " to "
+                 << hi << " again";
   }
+  DLOG(INFO) << "Read " << kind << " with ids up to " << hi;
 }
 
 MemgraphSource::IndexInfo MemgraphSource::ReadIndices() {
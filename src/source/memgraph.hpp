@@ -1,6 +1,7 @@
 #pragma once
 
 #include <functional>
+#include <memory>
 #include <set>
 #include <string>
 #include <utility>
@@ -8,7 +9,24 @@
 
 #include "memgraph_client.hpp"
 
-/// Class that reads from the Memgraph database.
+/// Class that reads from the Memgraph database. Nodes and relationships are
+/// each read by a single scan, where each row holds only the labels, the
+/// internal id and the properties of a node, or the edge type, the internal
+/// ids of the endpoints and the properties of a relationship, so that they
+/// can be grouped by label set or edge type on the client.
+///
+/// If the `page_size` is set, nodes and relationships are read in pages of at
+/// most `page_size` consecutive internal ids, each by its own query, so that
+/// no transaction on the source spans the whole scan. Rows of a page are
+/// buffered before they're passed on, and a page that fails is read again.
+/// Internal ids aren't indexed, so each page scans the whole graph, and the
+/// total cost of a paged read grows with the square of the graph size divided
+/// by the page size.
+///
+/// If there's more than one client, pages are read by all of them
+/// concurrently, and passed on one by one in the order they were read, so
+/// callbacks are still invoked from a single thread. Without a page size,
+/// the id range is split evenly between the clients.
 class MemgraphSource {
  public:
   struct IndexInfo {
@@ -21,7 +39,11 @@ class MemgraphSource {
     std::vector<std::pair<std::string, std::set<std::string>>> unique;
   };
 
-  explicit MemgraphSource(std::unique_ptr<MemgraphClient> client);
+  explicit MemgraphSource(std::unique_ptr<MemgraphClient> client,
+                          size_t page_size = 0);
+
+  MemgraphSource(std::vector<std::unique_ptr<MemgraphClient>> clients,
+                 size_t page_size);
 
   MemgraphSource(const MemgraphSource &) = delete;
   MemgraphSource(MemgraphSource &&) = default;
@@ -30,15 +52,56 @@ class MemgraphSource {
 
   ~MemgraphSource();
 
-  void ReadNodes(std::function<void(const mg::ConstNode &node)> callback);
+  /// Node read from the source. It's valid only during the callback.
+  struct Node {
+    const std::vector<std::string> &labels;
+    int64_t id;
+    mg::ConstMap properties;
+  };
+
+  void ReadNodes(std::function<void(const Node &node)> callback);
+
+  /// Relationship read from the source, which refers to its endpoints by
+  /// their internal ids. It's valid only during the callback.
+  struct Relationship {
+    const std::string &type;
+    int64_t from;
+    int64_t to;
+    mg::ConstMap properties;
+  };
 
-  void ReadRelationships(
-      std::function<void(const mg::ConstRelationship &rel)> callback);
+  void ReadRelationships(std::function<void(const Relationship &rel)> callback);
 
   IndexInfo ReadIndices();
 
   ConstraintInfo ReadConstraints();
 
  private:
-  std::unique_ptr<MemgraphClient> client_;
+  using RowCallback = std::function<void(const std::vector<mg::Value> &row)>;
+
+  using Page = std::vector<std::vector<mg::Value>>;
+
+  /// Executes the unpaged `statement`, and invokes the `callback` with each of
+  /// the returned rows.
+  void Read(const std::string &statement, const std::string &kind,
+            const RowCallback &callback);
+
+  /// Reads pages of the paged `statement`, which takes the `lo` and `hi`
+  /// bounds of internal ids, between the minimum and maximum id returned by
+  /// the `bounds_statement`.
+  void ReadPages(const std::string &bounds_statement,
+                 const std::string &statement, const std::string &kind,
+                 const RowCallback &callback);
+
+  /// Reads all rows of the page of ids between `lo` and `hi` into the `page`
+  /// using the given `client`. It aborts if the page can't be read after a
+  /// few attempts.
+  static void ReadPage(MemgraphClient *client, const std::string &statement,
+                       const std::string &kind, int64_t lo, int64_t hi,
+                       Page *page);
+
+  /// The first client is also used for all reads that aren't paged.
+  std::vector<std::unique_ptr<MemgraphClient>> clients_;
+  MemgraphClient *client_;
+  size_t page_size_;
 };
@@ -442,7 +442,7 @@ SchemaInfo MysqlSource::GetSchemaInfo() {
 
 void MysqlSource::ReadTable(
     const SchemaInfo::Table &table,
-    std::function<void(const std::vector<mg::Value> &)> callback) {
+    std::function<void(std::vector<mg::Value> &&)> callback) {
   DLOG(INFO) << "Reading data from table '" << table.name << "' in schema '"
              << table.schema << "'";
 
@@ -462,7 +462,7 @@ void MysqlSource::ReadTable(
           << "Received unexpected results from table '" << table.name
           << "' in schema '" << table.schema << "'!";
       std::vector<mg::Value> mg_row = ConvertRow(row);
-      callback(mg_row);
+      callback(std::move(mg_row));
     }
   } catch (mysqlx::Error &e) {
     LOG(FATAL) << "Failed to read table '" << table.name << "' in schema '"
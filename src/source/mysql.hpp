@@ -45,7 +45,7 @@ class MysqlSource {
   SchemaInfo GetSchemaInfo();
 
   void ReadTable(const SchemaInfo::Table &table,
-                 std::function<void(const std::vector<mg::Value> &)> callback);
+                 std::function<void(std::vector<mg::Value> &&)> callback);
 
  private:
   std::unique_ptr<MysqlClient> client_;
@@ -453,7 +453,7 @@ SchemaInfo PostgresqlSource::GetSchemaInfo() {
 
 void PostgresqlSource::ReadTable(
     const SchemaInfo::Table &table,
-    std::function<void(const std::vector<mg::Value> &)> callback) {
+    std::function<void(std::vector<mg::Value> &&)> callback) {
   std::ostringstream statement;
   statement << "SELECT ";
   utils::PrintIterable(statement, table.columns, ", ",
@@ -469,6 +469,6 @@ void PostgresqlSource::ReadTable(
     CHECK(result->size() == table.columns.size())
         << "Received unexpected result while reading table '" << table.name
         << "'!";
-    callback(*result);
+    callback(std::move(*result));
   }
 }
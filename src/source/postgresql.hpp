@@ -121,9 +121,10 @@ class PostgresqlSource {
 
   /// Reads the given `table` row by row. Order of returned values corresponds
   /// to the order of columns listed in the `table`. If `distinct` is set to
-  /// `true`, duplicates will be skipped.
+  /// `true`, duplicates will be skipped. Ownership of each row is passed to the
+  /// `callback`, so its values can be moved instead of copied.
   void ReadTable(const SchemaInfo::Table &table,
-                 std::function<void(const std::vector<mg::Value> &)> callback);
+                 std::function<void(std::vector<mg::Value> &&)> callback);
 
  private:
   std::unique_ptr<PostgresqlClient> client_;
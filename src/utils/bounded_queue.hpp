@@ -0,0 +1,82 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+namespace utils {
+
+/**
+ * A thread-safe FIFO queue with limited capacity. Producers are blocked while
+ * the queue is full and consumers are blocked while the queue is empty.
+ *
+ * @tparam T type of queued items.
+ */
+template <typename T>
+class BoundedQueue {
+ public:
+  explicit BoundedQueue(size_t capacity) : capacity_(capacity) {}
+
+  BoundedQueue(const BoundedQueue &) = delete;
+  BoundedQueue(BoundedQueue &&) = delete;
+  BoundedQueue &operator=(const BoundedQueue &) = delete;
+  BoundedQueue &operator=(BoundedQueue &&) = delete;
+
+  /**
+   * Pushes the `item` to the end of the queue, blocking while the queue is
+   * full.
+   *
+   * @return `false` if the queue is closed and the item wasn't pushed.
+   */
+  bool Push(T item) {
+    std::unique_lock<std::mutex> guard(lock_);
+    not_full_.wait(guard,
+                   [this] { return closed_ || queue_.size() < capacity_; });
+    if (closed_) {
+      return false;
+    }
+    queue_.push_back(std::move(item));
+    not_empty_.notify_one();
+    return true;
+  }
+
+  /**
+   * Pops an item from the front of the queue, blocking while the queue is
+   * empty.
+   *
+   * @return `std::nullopt` once the queue is closed and all items are popped.
+   */
+  std::optional<T> Pop() {
+    std::unique_lock<std::mutex> guard(lock_);
+    not_empty_.wait(guard, [this] { return closed_ || !queue_.empty(); });
+    if (queue_.empty()) {
+      return std::nullopt;
+    }
+    std::optional<T> item(std::move(queue_.front()));
+    queue_.pop_front();
+    not_full_.notify_one();
+    return item;
+  }
+
+  /**
+   * Closes the queue. Items which are already in the queue can still be popped,
+   * but no new items can be pushed.
+   */
+  void Close() {
+    std::lock_guard<std::mutex> guard(lock_);
+    closed_ = true;
+    not_empty_.notify_all();
+    not_full_.notify_all();
+  }
+
+ private:
+  size_t capacity_;
+  bool closed_{false};
+  std::deque<T> queue_;
+  std::mutex lock_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+};
+
+}  // namespace utils
@@ -1,5 +1,7 @@
 import mgclient
 
+import pathlib
+
 MEMGRAPH_DESTINATION_HOST = '127.0.0.1'
 MEMGRAPH_DESTINATION_PORT = 7687
 
@@ -37,13 +39,64 @@ def clean_memgraph(host, port):
     assert len(rows) == 0, "Failed to clean constraints"
 
 
-def validate_imdb(labels_with_prefix):
-    label_prefix = 'imdb_' if labels_with_prefix else ''
+def count_nodes(host, port, label=None):
+    conn = mgclient.connect(host=host, port=port)
+    conn.autocommit = True
+    cursor = conn.cursor()
+    pattern = f'(n:{label})' if label else '(n)'
+    cursor.execute(f'MATCH {pattern} RETURN COUNT(n)')
+    row = cursor.fetchone()
+    assert not cursor.fetchone()
+    return row[0]
+
+
+def count_relationships(host, port):
+    conn = mgclient.connect(host=host, port=port)
+    conn.autocommit = True
+    cursor = conn.cursor()
+    cursor.execute('MATCH ()-[e]->() RETURN COUNT(e)')
+    row = cursor.fetchone()
+    assert not cursor.fetchone()
+    return row[0]
+
+
+def replay_cypherl(directory):
     conn = mgclient.connect(
         host=MEMGRAPH_DESTINATION_HOST,
         port=MEMGRAPH_DESTINATION_PORT)
     conn.autocommit = True
     cursor = conn.cursor()
+    # Files are named by their stage, so replaying them in the order of their
+    # names replays the stages in order.
+    for path in sorted(pathlib.Path(directory).glob('*.cypherl')):
+        with open(path, 'r') as dump:
+            for query in dump.readlines():
+                cursor.execute(query)
+                cursor.fetchall()
+
+
+def validate_no_internal_data():
+    assert count_nodes(
+        MEMGRAPH_DESTINATION_HOST,
+        MEMGRAPH_DESTINATION_PORT,
+        '__mg_vertex__') == 0, "Internal label wasn't removed"
+    conn = mgclient.connect(
+        host=MEMGRAPH_DESTINATION_HOST,
+        port=MEMGRAPH_DESTINATION_PORT)
+    conn.autocommit = True
+    cursor = conn.cursor()
+    cursor.execute('MATCH (n) WHERE n.__mg_id__ IS NOT NULL RETURN COUNT(n)')
+    row = cursor.fetchone()
+    assert row[0] == 0, "Internal property wasn't removed"
+    assert not cursor.fetchone()
+
+
+def validate_imdb(labels_with_prefix, host=MEMGRAPH_DESTINATION_HOST,
+                  port=MEMGRAPH_DESTINATION_PORT):
+    label_prefix = 'imdb_' if labels_with_prefix else ''
+    conn = mgclient.connect(host=host, port=port)
+    conn.autocommit = True
+    cursor = conn.cursor()
 
     cursor.execute(
         f'MATCH (a:{label_prefix}actors {{name: "Christian Bale"}})-[:{label_prefix}movie_roles]->(m:{label_prefix}movies) '
@@ -28,25 +28,11 @@ def setup_source_memgraph():
             cursor.fetchall()
 
 
-if __name__ == '__main__':
-    print("Preparing destination Memgraph")
+def migrate(description, *flags):
+    print(f"Migrating data from Memgraph to Memgraph{description}")
     memgraph.clean_memgraph(
         memgraph.MEMGRAPH_DESTINATION_HOST,
         memgraph.MEMGRAPH_DESTINATION_PORT)
-    atexit.register(
-        lambda: memgraph.clean_memgraph(
-            memgraph.MEMGRAPH_DESTINATION_HOST,
-            memgraph.MEMGRAPH_DESTINATION_PORT))
-
-    print("Preparing source Memgraph")
-    memgraph.clean_memgraph(MEMGRAPH_SOURCE_HOST, MEMGRAPH_SOURCE_PORT)
-    atexit.register(
-        lambda: memgraph.clean_memgraph(
-            MEMGRAPH_SOURCE_HOST,
-            MEMGRAPH_SOURCE_PORT))
-    setup_source_memgraph()
-
-    print("Migrating data from Memgraph to Memgraph")
     subprocess.run([str(BUILD_DIR / 'src/mgmigrate'),
                     '--source-kind=memgraph',
                     '--source-host',
@@ -59,9 +45,40 @@ if __name__ == '__main__':
                     '--destination-port',
                     str(memgraph.MEMGRAPH_DESTINATION_PORT),
                     '--destination-use-ssl=false',
+                    *flags,
                     ], check=True, stderr=subprocess.STDOUT)
     print("Migration done")
 
     print("Validating Memgraph data")
     memgraph.validate_imdb(False)
+    memgraph.validate_no_internal_data()
     print("Validation passed")
+
+
+if __name__ == '__main__':
+    print("Preparing destination Memgraph")
+    memgraph.clean_memgraph(
+        memgraph.MEMGRAPH_DESTINATION_HOST,
+        memgraph.MEMGRAPH_DESTINATION_PORT)
+    atexit.register(
+        lambda: memgraph.clean_memgraph(
+            memgraph.MEMGRAPH_DESTINATION_HOST,
+            memgraph.MEMGRAPH_DESTINATION_PORT))
+
+    print("Preparing source Memgraph")
+    memgraph.clean_memgraph(MEMGRAPH_SOURCE_HOST, MEMGRAPH_SOURCE_PORT)
+    atexit.register(
+        lambda: memgraph.clean_memgraph(
+            MEMGRAPH_SOURCE_HOST,
+            MEMGRAPH_SOURCE_PORT))
+    setup_source_memgraph()
+
+    migrate('')
+    migrate(' with the id map', '--memgraph-id-map')
+    # The migration is aborted if the counts don't match.
+    migrate(' with count verification', '--verify-counts')
+    migrate(' in pages', '--source-page-size=10000')
+    migrate(' over multiple connections', '--source-connections=3')
+    migrate(' in pages over multiple connections',
+            '--source-page-size=10000',
+            '--source-connections=3')
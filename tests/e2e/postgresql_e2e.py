@@ -8,6 +8,10 @@ import memgraph
 import subprocess
 import pathlib
 import atexit
+import csv
+import os
+import shutil
+import tempfile
 
 SCRIPT_DIR = pathlib.Path(__file__).resolve().parent
 PROJECT_DIR = SCRIPT_DIR.parents[1]
@@ -18,6 +22,18 @@ POSTGRES_USERNAME = 'postgres'
 POSTGRES_PASSWORD = 'postgres'
 POSTGRES_PORT = 5432
 
+NODE_TABLES = ['actors', 'movies', 'tvseries', 'tvepisodes']
+
+# Memgraph used as the second destination, which is the source of the Memgraph
+# e2e test.
+MEMGRAPH_SECOND_DESTINATION_HOST = '127.0.0.1'
+MEMGRAPH_SECOND_DESTINATION_PORT = 7688
+
+# CSV staging directory, which has to be shared with the destination Memgraph
+# under the same path.
+CSV_STAGING_DIR = pathlib.Path(
+    os.environ.get('CSV_STAGING_DIR', '/tmp/mgmigrate_csv'))
+
 
 def setup_postgres():
     conn = psycopg2.connect(
@@ -50,21 +66,11 @@ def teardown_postgres():
     cursor.execute("DROP DATABASE imdb")
 
 
-if __name__ == '__main__':
-    print("Preparing Memgraph")
+def migrate(description, *flags):
+    print(f"Migrating data from Postgres to Memgraph{description}")
     memgraph.clean_memgraph(
         memgraph.MEMGRAPH_DESTINATION_HOST,
         memgraph.MEMGRAPH_DESTINATION_PORT)
-    atexit.register(
-        lambda: memgraph.clean_memgraph(
-            memgraph.MEMGRAPH_DESTINATION_HOST,
-            memgraph.MEMGRAPH_DESTINATION_PORT))
-
-    print("Preparing Postgres")
-    setup_postgres()
-    atexit.register(teardown_postgres)
-
-    print("Migrating data from Postgres to Memgraph")
     subprocess.run([str(BUILD_DIR / 'src/mgmigrate'),
                     '--source-kind=postgresql',
                     '--source-host',
@@ -81,9 +87,121 @@ if __name__ == '__main__':
                     '--destination-port',
                     str(memgraph.MEMGRAPH_DESTINATION_PORT),
                     '--destination-use-ssl=false',
+                    *flags,
                     ], check=True, stderr=subprocess.STDOUT)
     print("Migration done")
 
+
+def validate():
     print("Validating Memgraph data")
     memgraph.validate_imdb(False)
     print("Validation passed")
+
+
+if __name__ == '__main__':
+    print("Preparing Memgraph")
+    memgraph.clean_memgraph(
+        memgraph.MEMGRAPH_DESTINATION_HOST,
+        memgraph.MEMGRAPH_DESTINATION_PORT)
+    atexit.register(
+        lambda: memgraph.clean_memgraph(
+            memgraph.MEMGRAPH_DESTINATION_HOST,
+            memgraph.MEMGRAPH_DESTINATION_PORT))
+
+    print("Preparing Postgres")
+    setup_postgres()
+    atexit.register(teardown_postgres)
+
+    migrate('')
+    validate()
+    expected_nodes = {
+        label: memgraph.count_nodes(
+            memgraph.MEMGRAPH_DESTINATION_HOST,
+            memgraph.MEMGRAPH_DESTINATION_PORT,
+            label) for label in NODE_TABLES}
+    expected_relationships = memgraph.count_relationships(
+        memgraph.MEMGRAPH_DESTINATION_HOST,
+        memgraph.MEMGRAPH_DESTINATION_PORT)
+
+    # The migration is aborted if the counts don't match.
+    migrate(' with count verification', '--verify-counts')
+    validate()
+
+    with tempfile.TemporaryDirectory() as directory:
+        migrate(' as .cypherl files',
+                '--destination-cypherl-directory',
+                directory,
+                '--destination-cypherl-statements=100')
+        print("Replaying .cypherl files")
+        memgraph.replay_cypherl(directory)
+        validate()
+
+    print("Preparing the second Memgraph")
+    memgraph.clean_memgraph(
+        MEMGRAPH_SECOND_DESTINATION_HOST,
+        MEMGRAPH_SECOND_DESTINATION_PORT)
+    atexit.register(
+        lambda: memgraph.clean_memgraph(
+            MEMGRAPH_SECOND_DESTINATION_HOST,
+            MEMGRAPH_SECOND_DESTINATION_PORT))
+    destinations = ','.join([
+        f'{memgraph.MEMGRAPH_DESTINATION_HOST}:'
+        f'{memgraph.MEMGRAPH_DESTINATION_PORT}',
+        f'{MEMGRAPH_SECOND_DESTINATION_HOST}:'
+        f'{MEMGRAPH_SECOND_DESTINATION_PORT}'])
+    migrate(' with two destinations', '--destinations', destinations)
+    validate()
+    memgraph.validate_imdb(
+        False,
+        MEMGRAPH_SECOND_DESTINATION_HOST,
+        MEMGRAPH_SECOND_DESTINATION_PORT)
+    memgraph.clean_memgraph(
+        MEMGRAPH_SECOND_DESTINATION_HOST,
+        MEMGRAPH_SECOND_DESTINATION_PORT)
+
+    migrate(' with two shards',
+            '--destinations',
+            destinations,
+            '--shard-destinations',
+            '--shard-labels=actors=0,movies=1')
+    print("Validating shards")
+    shards = [
+        (memgraph.MEMGRAPH_DESTINATION_HOST,
+         memgraph.MEMGRAPH_DESTINATION_PORT),
+        (MEMGRAPH_SECOND_DESTINATION_HOST,
+         MEMGRAPH_SECOND_DESTINATION_PORT)]
+    for label, expected in expected_nodes.items():
+        counts = [memgraph.count_nodes(host, port, label)
+                  for host, port in shards]
+        assert sum(counts) == expected, \
+            f"Found {counts} {label} in shards, expected {expected} in total"
+        if label == 'actors':
+            assert counts[1] == 0, "Actors weren't assigned to the first shard"
+        if label == 'movies':
+            assert counts[0] == 0, "Movies weren't assigned to the second shard"
+    # Cross-shard relationships are written once, with ghost end nodes.
+    relationships = sum(memgraph.count_relationships(host, port)
+                        for host, port in shards)
+    assert relationships == expected_relationships, \
+        f"Found {relationships} relationships in shards, " \
+        f"expected {expected_relationships}"
+    print("Validation passed")
+    memgraph.clean_memgraph(
+        MEMGRAPH_SECOND_DESTINATION_HOST,
+        MEMGRAPH_SECOND_DESTINATION_PORT)
+
+    staging_directory = CSV_STAGING_DIR / 'imdb'
+    shutil.rmtree(staging_directory, ignore_errors=True)
+    atexit.register(
+        lambda: shutil.rmtree(staging_directory, ignore_errors=True))
+    migrate(' through CSV files',
+            '--csv-staging-directory',
+            str(staging_directory),
+            '--csv-staging-rows=1000')
+    validate()
+    with open(staging_directory / 'manifest.csv', 'r') as manifest:
+        files = list(csv.DictReader(manifest))
+    assert len(files) > 0, "No CSV files were staged"
+    for file in files:
+        assert (staging_directory / file['file']).is_file(), \
+            f"Staged file {file['file']} is missing"
@@ -0,0 +1,102 @@
+#include <chrono>
+
+#include <gtest/gtest.h>
+
+#include "batch_controller.hpp"
+
+namespace {
+
+using std::chrono::milliseconds;
+
+/// Number of batches per writer in a measurement window.
+const size_t kWindowBatches = 8;
+
+BatchController::Options MakeOptions(size_t max_writers) {
+  BatchController::Options options;
+  options.initial_batch_size = 1000;
+  options.min_batch_size = 10;
+  options.max_batch_size = 100000;
+  options.max_writers = max_writers;
+  options.latency_budget = milliseconds(500);
+  options.memory_budget = 1024 * 1024 * 1024;
+  return options;
+}
+
+/// Observes a full window of batches of the `controller`, each with the given
+/// `latency`, where only the last batch causes `conflicts` retries. Returns
+/// the result of the last observation.
+bool ObserveWindow(BatchController *controller, milliseconds latency,
+                   size_t conflicts = 0, size_t bytes = 0) {
+  const auto batches = kWindowBatches * controller->writers();
+  for (size_t i = 0; i + 1 < batches; ++i) {
+    EXPECT_FALSE(controller->Observe(controller->batch_size(), bytes, latency,
+                                     0));
+  }
+  return controller->Observe(controller->batch_size(), bytes, latency,
+                             conflicts);
+}
+
+}  // namespace
+
+TEST(BatchController, InitialSettings) {
+  auto options = MakeOptions(4);
+  options.initial_batch_size = 1;
+  const BatchController controller(options);
+  EXPECT_EQ(controller.batch_size(), 10);
+  EXPECT_EQ(controller.writers(), 4);
+}
+
+TEST(BatchController, GrowsBatchesWhileFast) {
+  BatchController controller(MakeOptions(2));
+  EXPECT_FALSE(ObserveWindow(&controller, milliseconds(1)));
+  EXPECT_EQ(controller.batch_size(), 1500);
+  EXPECT_EQ(controller.writers(), 2);
+}
+
+TEST(BatchController, ShrinksBatchesOverLatencyBudget) {
+  BatchController controller(MakeOptions(2));
+  EXPECT_FALSE(ObserveWindow(&controller, milliseconds(1000)));
+  EXPECT_EQ(controller.batch_size(), 500);
+  EXPECT_EQ(controller.writers(), 2);
+}
+
+TEST(BatchController, BacksOffOnConflicts) {
+  BatchController controller(MakeOptions(2));
+  EXPECT_TRUE(ObserveWindow(&controller, milliseconds(1), 1));
+  EXPECT_EQ(controller.batch_size(), 500);
+  EXPECT_EQ(controller.writers(), 1);
+  // There's always at least one writer, and batches don't shrink below the
+  // minimum size.
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_FALSE(ObserveWindow(&controller, milliseconds(1), 1));
+  }
+  EXPECT_EQ(controller.batch_size(), 10);
+  EXPECT_EQ(controller.writers(), 1);
+}
+
+TEST(BatchController, BatchesFitMemoryBudget) {
+  auto options = MakeOptions(2);
+  options.transaction_batches = 5;
+  options.memory_budget = 100000;
+  BatchController controller(options);
+  // Rows take 10 bytes each, so 10 uncommitted batches fit 1000 rows each.
+  ObserveWindow(&controller, milliseconds(1), 0,
+                controller.batch_size() * 10);
+  EXPECT_EQ(controller.batch_size(), 1000);
+}
+
+TEST(BatchController, FixedWriters) {
+  BatchController controller(MakeOptions(3));
+  EXPECT_TRUE(ObserveWindow(&controller, milliseconds(1), 1));
+  EXPECT_EQ(controller.writers(), 2);
+
+  controller.FixWriters();
+  EXPECT_EQ(controller.writers(), 3);
+  EXPECT_FALSE(ObserveWindow(&controller, milliseconds(1), 1));
+  EXPECT_EQ(controller.writers(), 3);
+
+  // Writers are tuned again after the summary.
+  controller.LogSummary("test");
+  EXPECT_TRUE(ObserveWindow(&controller, milliseconds(1), 1));
+  EXPECT_EQ(controller.writers(), 2);
+}
@@ -0,0 +1,201 @@
+#include <deque>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "batch_writer.hpp"
+
+namespace {
+
+/// Calls made to a `ScriptedClient`, and the errors its executions fail with.
+struct Script {
+  /// Errors of consecutive executions, where an empty error means success.
+  /// Executions succeed once the errors run out.
+  std::deque<std::string> errors;
+  bool commit_fails{false};
+  size_t executions{0};
+  size_t begins{0};
+  size_t commits{0};
+  size_t rollbacks{0};
+};
+
+/// Client which fails executions as scripted, and otherwise reports every row
+/// of a relationship batch as a single created relationship. Errors are
+/// thrown while fetching the results, as the destination reports them.
+class ScriptedClient : public MemgraphClient {
+ public:
+  explicit ScriptedClient(Script *script) : script_(script) {}
+
+  bool Execute(const std::string &) override { return false; }
+
+  bool Execute(const std::string &, const mg::ConstMap &params) override {
+    ++script_->executions;
+    error_.clear();
+    if (!script_->errors.empty()) {
+      error_ = std::move(script_->errors.front());
+      script_->errors.pop_front();
+    }
+    result_ = static_cast<int64_t>(params["batch"].ValueList().size());
+    return true;
+  }
+
+  std::optional<std::vector<mg::Value>> FetchOne() override {
+    if (!error_.empty()) {
+      const auto error = std::move(error_);
+      error_.clear();
+      result_.reset();
+      throw std::runtime_error(error);
+    }
+    if (!result_) {
+      return std::nullopt;
+    }
+    std::vector<mg::Value> row;
+    row.emplace_back(*result_);
+    result_.reset();
+    return row;
+  }
+
+  bool Begin() override {
+    ++script_->begins;
+    return true;
+  }
+
+  bool Commit() override {
+    ++script_->commits;
+    return !script_->commit_fails;
+  }
+
+  bool Rollback() override {
+    ++script_->rollbacks;
+    return true;
+  }
+
+ private:
+  Script *script_;
+  std::string error_;
+  std::optional<int64_t> result_;
+};
+
+const char *kConflictError =
+    "Cannot resolve conflicting transactions. You can retry this transaction.";
+
+/// Returns a compiled query which creates relationships and returns their
+/// number per batch.
+const CompiledQuery *GetQuery(QueryShapeCache *cache) {
+  RelationshipShape shape;
+  shape.label1 = "Person";
+  shape.id1 = {"id"};
+  shape.label2 = "Company";
+  shape.id2 = {"id"};
+  shape.edge_type = "WORKS_AT";
+  shape.count_per_batch = true;
+  return cache->Get(shape);
+}
+
+WriteBatch MakeBatch(const CompiledQuery *query, size_t rows) {
+  mg::List list(rows);
+  for (size_t i = 0; i < rows; ++i) {
+    list.Append(mg::Value(mg::List(std::vector<mg::Value>{
+        mg::Value(static_cast<int64_t>(i)), mg::Value(int64_t{0})})));
+  }
+  return WriteBatch{query, MakeBatchParams(std::move(list)), rows, 0};
+}
+
+/// Returns a synchronous pool writing through a single scripted client, which
+/// counts the relationships reported to its callback.
+std::unique_ptr<WriterPool> MakePool(Script *script,
+                                     const BatchOptions &options,
+                                     size_t *created) {
+  std::vector<std::unique_ptr<MemgraphClient>> clients;
+  clients.push_back(std::make_unique<ScriptedClient>(script));
+  return std::make_unique<WriterPool>(
+      std::move(clients), options,
+      [created](const CompiledQuery &, size_t,
+                const std::vector<size_t> &batch_created) {
+        for (const auto count : batch_created) {
+          *created += count;
+        }
+      });
+}
+
+}  // namespace
+
+TEST(WriterPool, RetriesConflicts) {
+  QueryShapeCache cache;
+  Script script;
+  script.errors = {kConflictError, kConflictError};
+  size_t created = 0;
+  auto pool = MakePool(&script, BatchOptions(), &created);
+  pool->Write(MakeBatch(GetQuery(&cache), 3));
+  pool->Sync();
+  EXPECT_EQ(script.executions, 3);
+  EXPECT_EQ(created, 3);
+}
+
+TEST(WriterPool, ReplaysWholeTransaction) {
+  QueryShapeCache cache;
+  Script script;
+  // The second batch of the transaction conflicts once.
+  script.errors = {"", kConflictError};
+  BatchOptions options;
+  options.transaction_batches = 2;
+  size_t created = 0;
+  auto pool = MakePool(&script, options, &created);
+  pool->Write(MakeBatch(GetQuery(&cache), 2));
+  pool->Write(MakeBatch(GetQuery(&cache), 5));
+  pool->Sync();
+  // Both batches are written again, and the callback is invoked again for
+  // the first one.
+  EXPECT_EQ(script.executions, 4);
+  EXPECT_EQ(script.begins, 2);
+  EXPECT_EQ(script.rollbacks, 1);
+  EXPECT_EQ(script.commits, 1);
+  EXPECT_EQ(created, 2 + 2 + 5);
+}
+
+TEST(WriterPool, OtherErrorsAreNotRetried) {
+  QueryShapeCache cache;
+  Script script;
+  script.errors = {"Connection lost"};
+  size_t created = 0;
+  auto pool = MakePool(&script, BatchOptions(), &created);
+  pool->Write(MakeBatch(GetQuery(&cache), 3));
+  EXPECT_EQ(script.executions, 1);
+  EXPECT_EQ(created, 0);
+  EXPECT_DEATH(pool->Sync(), "");
+}
+
+TEST(WriterPool, FailedCommitsAreNotRetried) {
+  QueryShapeCache cache;
+  Script script;
+  script.commit_fails = true;
+  BatchOptions options;
+  options.transaction_batches = 2;
+  size_t created = 0;
+  auto pool = MakePool(&script, options, &created);
+  pool->Write(MakeBatch(GetQuery(&cache), 3));
+  pool->Write(MakeBatch(GetQuery(&cache), 3));
+  // The transaction might have been committed, so it isn't written again.
+  EXPECT_EQ(script.executions, 2);
+  EXPECT_EQ(script.commits, 1);
+  EXPECT_DEATH(pool->Sync(), "");
+}
+
+TEST(WriterPool, RetriesAreLimited) {
+  QueryShapeCache cache;
+  Script script;
+  script.errors = {kConflictError, kConflictError, kConflictError,
+                   kConflictError};
+  BatchOptions options;
+  options.max_retries = 2;
+  size_t created = 0;
+  auto pool = MakePool(&script, options, &created);
+  pool->Write(MakeBatch(GetQuery(&cache), 3));
+  EXPECT_EQ(script.executions, 3);
+  EXPECT_EQ(created, 0);
+  EXPECT_DEATH(pool->Sync(), "");
+}
@@ -0,0 +1,130 @@
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "count_verifier.hpp"
+
+namespace {
+
+/// Client which answers counting statements with the given counts.
+class FakeClient : public MemgraphClient {
+ public:
+  explicit FakeClient(std::map<std::string, int64_t> counts)
+      : counts_(std::move(counts)) {}
+
+  bool Execute(const std::string &statement) override {
+    rows_.clear();
+    const auto it = counts_.find(statement);
+    rows_.push_back({mg::Value(it == counts_.end() ? 0 : it->second)});
+    return true;
+  }
+
+  bool Execute(const std::string &, const mg::ConstMap &) override {
+    return false;
+  }
+
+  std::optional<std::vector<mg::Value>> FetchOne() override {
+    if (rows_.empty()) {
+      return std::nullopt;
+    }
+    auto row = std::move(rows_.back());
+    rows_.pop_back();
+    return row;
+  }
+
+  bool Begin() override { return false; }
+
+  bool Commit() override { return false; }
+
+  bool Rollback() override { return false; }
+
+ private:
+  std::map<std::string, int64_t> counts_;
+  std::vector<std::vector<mg::Value>> rows_;
+};
+
+const CompiledQuery *GetNodeQuery(QueryShapeCache *cache) {
+  NodeShape shape;
+  shape.labels = {"Person", "Employee"};
+  shape.properties = {"id"};
+  return cache->Get(shape);
+}
+
+const CompiledQuery *GetRelationshipQuery(QueryShapeCache *cache,
+                                          bool use_merge = false) {
+  RelationshipShape shape;
+  shape.label1 = "Person";
+  shape.id1 = {"id"};
+  shape.label2 = "Person";
+  shape.id2 = {"id"};
+  shape.edge_type = "KNOWS";
+  shape.use_merge = use_merge;
+  return cache->Get(shape);
+}
+
+/// Returns the counts of a destination with 10 employees who know each other
+/// through `relationships` relationships.
+std::map<std::string, int64_t> MakeCounts(int64_t relationships) {
+  return {{"MATCH (u) RETURN COUNT(u);", 10},
+          {"MATCH (u:`Person`) RETURN COUNT(u);", 10},
+          {"MATCH (u:`Employee`) RETURN COUNT(u);", 10},
+          {"MATCH ()-[e]->() RETURN COUNT(e);", relationships},
+          {"MATCH ()-[e:`KNOWS`]->() RETURN COUNT(e);", relationships}};
+}
+
+}  // namespace
+
+TEST(CountVerifier, MatchingCounts) {
+  QueryShapeCache cache;
+  CountVerifier verifier;
+  verifier.Expect(GetNodeQuery(&cache), 4);
+  verifier.Expect(GetNodeQuery(&cache), 6);
+  verifier.Expect(GetRelationshipQuery(&cache), 20);
+  FakeClient client(MakeCounts(20));
+  verifier.Verify(&client);
+}
+
+TEST(CountVerifier, EmptyMigration) {
+  CountVerifier verifier;
+  FakeClient client({});
+  verifier.Verify(&client);
+}
+
+TEST(CountVerifier, MergedRelationshipsAreAnUpperBound) {
+  QueryShapeCache cache;
+  CountVerifier verifier;
+  verifier.Expect(GetNodeQuery(&cache), 10);
+  verifier.Expect(GetRelationshipQuery(&cache, true), 20);
+  FakeClient client(MakeCounts(15));
+  verifier.Verify(&client);
+}
+
+TEST(CountVerifierDeathTest, MissingNodes) {
+  QueryShapeCache cache;
+  CountVerifier verifier;
+  verifier.Expect(GetNodeQuery(&cache), 11);
+  verifier.Expect(GetRelationshipQuery(&cache), 20);
+  FakeClient client(MakeCounts(20));
+  EXPECT_DEATH(verifier.Verify(&client), "");
+}
+
+TEST(CountVerifierDeathTest, MissingRelationships) {
+  QueryShapeCache cache;
+  CountVerifier verifier;
+  verifier.Expect(GetNodeQuery(&cache), 10);
+  verifier.Expect(GetRelationshipQuery(&cache), 20);
+  FakeClient client(MakeCounts(15));
+  EXPECT_DEATH(verifier.Verify(&client), "");
+}
+
+TEST(CountVerifierDeathTest, TooManyMergedRelationships) {
+  QueryShapeCache cache;
+  CountVerifier verifier;
+  verifier.Expect(GetNodeQuery(&cache), 10);
+  verifier.Expect(GetRelationshipQuery(&cache, true), 20);
+  FakeClient client(MakeCounts(21));
+  EXPECT_DEATH(verifier.Verify(&client), "");
+}
@@ -0,0 +1,134 @@
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "csv_staging.hpp"
+
+namespace {
+
+mg::List MakeRow(std::vector<mg::Value> values) {
+  return mg::List(std::move(values));
+}
+
+std::string ReadFile(const std::string &path) {
+  std::ifstream file(path);
+  std::ostringstream text;
+  text << file.rdbuf();
+  return text.str();
+}
+
+class CsvStagingFileTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    path_ = (std::filesystem::temp_directory_path() /
+             ("mg_migrate_csv_" +
+              std::string(::testing::UnitTest::GetInstance()
+                              ->current_test_info()
+                              ->name()) +
+              ".csv"))
+                .string();
+  }
+
+  void TearDown() override { std::filesystem::remove(path_); }
+
+  std::string path_;
+};
+
+}  // namespace
+
+TEST_F(CsvStagingFileTest, Encoding) {
+  CsvStagingFile file(path_, 5);
+  file.Write(MakeRow({mg::Value(true), mg::Value(int64_t{-7}),
+                      mg::Value(0.5), mg::Value("text"), mg::Value()}));
+  file.Write(MakeRow({mg::Value(false), mg::Value(), mg::Value(),
+                      mg::Value(""), mg::Value()}));
+  file.Close();
+
+  EXPECT_EQ(file.rows(), 2);
+  const std::vector<CsvColumnType> types{
+      CsvColumnType::kBool, CsvColumnType::kInt, CsvColumnType::kDouble,
+      CsvColumnType::kString, CsvColumnType::kNull};
+  EXPECT_EQ(file.column_types(), types);
+  // Strings are prefixed, so that an empty string differs from a null.
+  EXPECT_EQ(ReadFile(path_),
+            "c0,c1,c2,c3,c4\n"
+            "true,-7,0.5,'text,\n"
+            "false,,,',\n");
+}
+
+TEST_F(CsvStagingFileTest, QuotedStrings) {
+  CsvStagingFile file(path_, 1);
+  file.Write(MakeRow({mg::Value("a,b")}));
+  file.Write(MakeRow({mg::Value("say \"hi\"")}));
+  file.Write(MakeRow({mg::Value("two\nlines")}));
+  file.Close();
+
+  EXPECT_EQ(ReadFile(path_),
+            "c0\n"
+            "\"'a,b\"\n"
+            "\"'say \"\"hi\"\"\"\n"
+            "\"'two\nlines\"\n");
+}
+
+TEST_F(CsvStagingFileTest, DoublesKeepPrecision) {
+  CsvStagingFile file(path_, 1);
+  file.Write(MakeRow({mg::Value(0.1)}));
+  file.Close();
+
+  EXPECT_EQ(ReadFile(path_), "c0\n0.10000000000000001\n");
+}
+
+TEST_F(CsvStagingFileTest, IntegersArePromotedToDoubles) {
+  CsvStagingFile file(path_, 1);
+  file.Write(MakeRow({mg::Value(int64_t{1})}));
+  file.Write(MakeRow({mg::Value(2.5)}));
+  file.Write(MakeRow({mg::Value(int64_t{3})}));
+  file.Close();
+
+  EXPECT_EQ(file.column_types(),
+            std::vector<CsvColumnType>{CsvColumnType::kDouble});
+  EXPECT_EQ(ReadFile(path_), "c0\n1\n2.5\n3\n");
+}
+
+TEST_F(CsvStagingFileTest, NullColumnTakesFirstType) {
+  CsvStagingFile file(path_, 1);
+  file.Write(MakeRow({mg::Value()}));
+  EXPECT_EQ(file.column_types(),
+            std::vector<CsvColumnType>{CsvColumnType::kNull});
+  file.Write(MakeRow({mg::Value("x")}));
+  file.Close();
+
+  EXPECT_EQ(file.column_types(),
+            std::vector<CsvColumnType>{CsvColumnType::kString});
+}
+
+TEST_F(CsvStagingFileTest, MixedTypesAbort) {
+  EXPECT_DEATH(
+      {
+        CsvStagingFile file(path_, 1);
+        file.Write(MakeRow({mg::Value("x")}));
+        file.Write(MakeRow({mg::Value(int64_t{1})}));
+      },
+      "");
+}
+
+TEST_F(CsvStagingFileTest, RowSizeMismatchAborts) {
+  EXPECT_DEATH(
+      {
+        CsvStagingFile file(path_, 2);
+        file.Write(MakeRow({mg::Value("x")}));
+      },
+      "");
+}
+
+TEST(GetCsvColumnTypeName, Names) {
+  EXPECT_STREQ(GetCsvColumnTypeName(CsvColumnType::kNull), "null");
+  EXPECT_STREQ(GetCsvColumnTypeName(CsvColumnType::kBool), "bool");
+  EXPECT_STREQ(GetCsvColumnTypeName(CsvColumnType::kInt), "int");
+  EXPECT_STREQ(GetCsvColumnTypeName(CsvColumnType::kDouble), "double");
+  EXPECT_STREQ(GetCsvColumnTypeName(CsvColumnType::kString), "string");
+}
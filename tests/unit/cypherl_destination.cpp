@@ -0,0 +1,200 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "cypherl_destination.hpp"
+
+namespace {
+
+/// Returns the `statement` with the single `$x` parameter bound to `value`.
+std::string InlineValue(const std::string &statement, mg::Value value) {
+  mg::Map params(1);
+  params.Insert("x", std::move(value));
+  return InlineParams(statement, params.AsConstMap());
+}
+
+std::vector<std::string> ReadLines(const std::filesystem::path &path) {
+  std::ifstream file(path);
+  std::vector<std::string> lines;
+  std::string line;
+  while (std::getline(file, line)) {
+    lines.push_back(line);
+  }
+  return lines;
+}
+
+/// Returns names of the files in the `directory`, sorted.
+std::vector<std::string> ListFiles(const std::filesystem::path &directory) {
+  std::vector<std::string> names;
+  for (const auto &entry : std::filesystem::directory_iterator(directory)) {
+    names.push_back(entry.path().filename().string());
+  }
+  std::sort(names.begin(), names.end());
+  return names;
+}
+
+class CypherlFileClientTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    directory_ = std::filesystem::temp_directory_path() /
+                 ("mg_migrate_cypherl_" +
+                  std::string(::testing::UnitTest::GetInstance()
+                                  ->current_test_info()
+                                  ->name()));
+    std::filesystem::remove_all(directory_);
+  }
+
+  void TearDown() override { std::filesystem::remove_all(directory_); }
+
+  std::filesystem::path directory_;
+};
+
+}  // namespace
+
+TEST(InlineParams, Scalars) {
+  EXPECT_EQ(InlineValue("RETURN $x;", mg::Value()), "RETURN null;");
+  EXPECT_EQ(InlineValue("RETURN $x;", mg::Value(true)), "RETURN true;");
+  EXPECT_EQ(InlineValue("RETURN $x;", mg::Value(false)), "RETURN false;");
+  EXPECT_EQ(InlineValue("RETURN $x;", mg::Value(int64_t{-42})),
+            "RETURN -42;");
+  EXPECT_EQ(InlineValue("RETURN $x;", mg::Value(1.5)), "RETURN 1.5;");
+}
+
+TEST(InlineParams, DoublesStayDoubles) {
+  EXPECT_EQ(InlineValue("RETURN $x;", mg::Value(2.0)), "RETURN 2.0;");
+  EXPECT_EQ(InlineValue("RETURN $x;", mg::Value(1e20)), "RETURN 1e+20;");
+  EXPECT_EQ(InlineValue("RETURN $x;", mg::Value(0.1)),
+            "RETURN 0.10000000000000001;");
+  EXPECT_EQ(InlineValue("RETURN $x;",
+                        mg::Value(std::numeric_limits<double>::quiet_NaN())),
+            "RETURN toFloat('NaN');");
+  EXPECT_EQ(InlineValue("RETURN $x;",
+                        mg::Value(std::numeric_limits<double>::infinity())),
+            "RETURN toFloat('Inf');");
+  EXPECT_EQ(InlineValue("RETURN $x;",
+                        mg::Value(-std::numeric_limits<double>::infinity())),
+            "RETURN toFloat('-Inf');");
+}
+
+TEST(InlineParams, StringsAreEscaped) {
+  EXPECT_EQ(InlineValue("RETURN $x;", mg::Value("plain")),
+            "RETURN 'plain';");
+  EXPECT_EQ(InlineValue("RETURN $x;", mg::Value("it's a \\ path")),
+            "RETURN 'it\\'s a \\\\ path';");
+  EXPECT_EQ(InlineValue("RETURN $x;", mg::Value("a\nb\rc\td")),
+            "RETURN 'a\\nb\\rc\\td';");
+}
+
+TEST(InlineParams, ListsAndMaps) {
+  mg::Map map(2);
+  map.Insert("name", mg::Value("n"));
+  map.Insert("odd`key", mg::Value(int64_t{1}));
+  mg::List list(3);
+  list.Append(mg::Value(int64_t{1}));
+  list.Append(mg::Value());
+  list.Append(mg::Value(std::move(map)));
+  EXPECT_EQ(InlineValue("UNWIND $x AS row RETURN row;",
+                        mg::Value(std::move(list))),
+            "UNWIND [1, null, {`name`: 'n', `odd``key`: 1}] AS row RETURN "
+            "row;");
+}
+
+TEST(InlineParams, QuotesAndNames) {
+  mg::Map params(2);
+  params.Insert("a", mg::Value(int64_t{1}));
+  params.Insert("ab", mg::Value(int64_t{2}));
+  EXPECT_EQ(InlineParams("RETURN $a, $ab, '$a', \"$a\", `$a`;",
+                         params.AsConstMap()),
+            "RETURN 1, 2, '$a', \"$a\", `$a`;");
+}
+
+TEST(InlineParams, TemporalValues) {
+  EXPECT_EQ(InlineValue("RETURN $x;", mg::Value(mg::Date(0))),
+            "RETURN date('1970-01-01');");
+  EXPECT_EQ(InlineValue("RETURN $x;", mg::Value(mg::Date(19358))),
+            "RETURN date('2023-01-01');");
+  EXPECT_EQ(InlineValue("RETURN $x;", mg::Value(mg::Date(-719468))),
+            "RETURN date('0000-03-01');");
+  EXPECT_EQ(InlineValue("RETURN $x;", mg::Value(mg::Date(11016))),
+            "RETURN date('2000-02-29');");
+  EXPECT_EQ(InlineValue("RETURN $x;",
+                        mg::Value(mg::LocalTime(45296789012000))),
+            "RETURN localTime('12:34:56.789012');");
+  EXPECT_EQ(InlineValue("RETURN $x;", mg::Value(mg::LocalDateTime(
+                                          1672576496, 789012345))),
+            "RETURN localDateTime('2023-01-01T12:34:56.789012');");
+  EXPECT_EQ(InlineValue("RETURN $x;",
+                        mg::Value(mg::LocalDateTime(-1, 500000000))),
+            "RETURN localDateTime('1969-12-31T23:59:59.500000');");
+  EXPECT_EQ(InlineValue("RETURN $x;",
+                        mg::Value(mg::Duration(0, 2, -30, 1500))),
+            "RETURN duration({day: 2, second: -30, microsecond: 1});");
+}
+
+TEST(InlineParamsDeathTest, DurationWithMonths) {
+  EXPECT_DEATH(
+      InlineValue("RETURN $x;", mg::Value(mg::Duration(1, 0, 0, 0))), "");
+}
+
+TEST(InlineParamsDeathTest, MissingParam) {
+  const mg::Map params(0);
+  EXPECT_DEATH(InlineParams("RETURN $x;", params.AsConstMap()), "");
+}
+
+TEST_F(CypherlFileClientTest, TransactionsAreWrittenOnCommit) {
+  auto dump = std::make_shared<CypherlDump>(directory_, 100);
+  {
+    CypherlFileClient client(dump);
+    mg::Map params(1);
+    params.Insert("x", mg::Value(int64_t{1}));
+
+    ASSERT_TRUE(client.Begin());
+    ASSERT_TRUE(client.Execute("CREATE ({id: $x});", params.AsConstMap()));
+    ASSERT_TRUE(client.Rollback());
+    ASSERT_TRUE(client.Begin());
+    ASSERT_TRUE(client.Execute("CREATE ({id: $x});", params.AsConstMap()));
+    ASSERT_TRUE(client.Execute("CREATE ({id: $x});", params.AsConstMap()));
+    EXPECT_FALSE(client.Begin());
+    ASSERT_TRUE(client.Commit());
+    EXPECT_FALSE(client.Commit());
+  }
+
+  const auto files = ListFiles(directory_);
+  ASSERT_EQ(files.size(), 1);
+  EXPECT_EQ(files[0], "000000-0000-000000.cypherl");
+  const std::vector<std::string> expected{"CREATE ({id: 1});",
+                                          "CREATE ({id: 1});"};
+  EXPECT_EQ(ReadLines(directory_ / files[0]), expected);
+}
+
+TEST_F(CypherlFileClientTest, StagesAndRotation) {
+  auto dump = std::make_shared<CypherlDump>(directory_, 2);
+  {
+    CypherlFileClient first(dump);
+    CypherlFileClient second(dump);
+    const mg::Map params(0);
+    ASSERT_TRUE(first.Execute("CREATE ();", params.AsConstMap()));
+    ASSERT_TRUE(first.Execute("CREATE ();", params.AsConstMap()));
+    ASSERT_TRUE(first.Execute("CREATE ();", params.AsConstMap()));
+    ASSERT_TRUE(second.Execute("CREATE ();", params.AsConstMap()));
+    ASSERT_TRUE(first.Execute("CREATE INDEX ON :Node;"));
+    ASSERT_TRUE(second.Execute("CREATE ();", params.AsConstMap()));
+  }
+
+  const std::vector<std::string> expected{
+      "000000-0000-000000.cypherl", "000000-0000-000001.cypherl",
+      "000000-0001-000000.cypherl", "000001-0000-000000.cypherl",
+      "000002-0001-000000.cypherl"};
+  const auto files = ListFiles(directory_);
+  EXPECT_EQ(files, expected);
+  EXPECT_EQ(ReadLines(directory_ / files[0]).size(), 2);
+  EXPECT_EQ(ReadLines(directory_ / files[1]).size(), 1);
+  EXPECT_EQ(ReadLines(directory_ / files[3]),
+            std::vector<std::string>{"CREATE INDEX ON :Node;"});
+}
@@ -0,0 +1,230 @@
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "memgraph_destination.hpp"
+
+namespace {
+
+RelationshipShape MakeRelationshipShape() {
+  RelationshipShape shape;
+  shape.label1 = "Person";
+  shape.id1 = {"id"};
+  shape.label2 = "Company";
+  shape.id2 = {"id"};
+  shape.edge_type = "WORKS_AT";
+  return shape;
+}
+
+}  // namespace
+
+TEST(QueryShapeCache, Nodes) {
+  QueryShapeCache cache;
+  NodeShape shape;
+  shape.labels = {"Person"};
+  shape.properties = {"id", "name"};
+  const auto *query = cache.Get(shape);
+  EXPECT_EQ(query->statement,
+            "UNWIND $batch AS row CREATE (u:`Person` {`id`: row[0], `name`: "
+            "row[1]});");
+  EXPECT_EQ(query->row_size, 2);
+  EXPECT_FALSE(query->creates_relationships);
+  EXPECT_FALSE(query->returns_ids);
+  EXPECT_EQ(query->labels, std::vector<std::string>{"Person"});
+}
+
+TEST(QueryShapeCache, NodesWithIdsAndPropertyMap) {
+  QueryShapeCache cache;
+  NodeShape shape;
+  shape.labels = {"B", "A"};
+  shape.return_ids = true;
+  shape.property_map = true;
+  const auto *query = cache.Get(shape);
+  EXPECT_EQ(query->statement,
+            "UNWIND $batch AS row CREATE (u:`A`:`B`) SET u += row[1] RETURN "
+            "row[0], id(u);");
+  EXPECT_EQ(query->row_size, 2);
+  EXPECT_TRUE(query->returns_ids);
+}
+
+TEST(QueryShapeCache, NamesAreEscaped) {
+  QueryShapeCache cache;
+  NodeShape shape;
+  shape.labels = {"odd`label"};
+  shape.properties = {"odd`property"};
+  EXPECT_EQ(cache.Get(shape)->statement,
+            "UNWIND $batch AS row CREATE (u:`odd``label` {`odd``property`: "
+            "row[0]});");
+}
+
+TEST(QueryShapeCache, Relationships) {
+  QueryShapeCache cache;
+  auto shape = MakeRelationshipShape();
+  shape.properties = {"since"};
+  const auto *query = cache.Get(shape);
+  EXPECT_EQ(query->statement,
+            "UNWIND range(0, size($batch) - 1) AS i WITH i, $batch[i] AS row "
+            "MATCH (u:`Person`), (v:`Company`) WHERE u.`id` = row[0] AND "
+            "v.`id` = row[1] CREATE (u)-[:`WORKS_AT` {`since`: row[2]}]->(v) "
+            "RETURN i, COUNT(u);");
+  EXPECT_EQ(query->row_size, 3);
+  EXPECT_TRUE(query->creates_relationships);
+  EXPECT_EQ(query->label1, "Person");
+  EXPECT_EQ(query->id1_size, 1);
+  EXPECT_EQ(query->label2, "Company");
+  EXPECT_EQ(query->id2_size, 1);
+  EXPECT_EQ(query->edge_type, "WORKS_AT");
+}
+
+TEST(QueryShapeCache, MergedRelationshipsCountedPerBatch) {
+  QueryShapeCache cache;
+  auto shape = MakeRelationshipShape();
+  shape.use_merge = true;
+  shape.count_per_batch = true;
+  const auto *query = cache.Get(shape);
+  EXPECT_EQ(query->statement,
+            "UNWIND $batch AS row MATCH (u:`Person`), (v:`Company`) WHERE "
+            "u.`id` = row[0] AND v.`id` = row[1] MERGE (u)-[:`WORKS_AT`]->(v) "
+            "RETURN COUNT(u);");
+  EXPECT_TRUE(query->use_merge);
+  EXPECT_TRUE(query->count_per_batch);
+}
+
+TEST(QueryShapeCache, RelationshipsMatchedByIds) {
+  QueryShapeCache cache;
+  auto shape = MakeRelationshipShape();
+  shape.match_ids = true;
+  shape.property_map = true;
+  const auto *query = cache.Get(shape);
+  EXPECT_EQ(query->statement,
+            "UNWIND range(0, size($batch) - 1) AS i WITH i, $batch[i] AS row "
+            "MATCH (u), (v) WHERE id(u) = row[0] AND id(v) = row[1] CREATE "
+            "(u)-[e:`WORKS_AT`]->(v) SET e = row[2] RETURN i, COUNT(u);");
+  EXPECT_EQ(query->row_size, 3);
+  EXPECT_TRUE(query->label1.empty());
+  EXPECT_TRUE(query->label2.empty());
+}
+
+TEST(QueryShapeCache, MergedEndNodes) {
+  QueryShapeCache cache;
+  auto shape = MakeRelationshipShape();
+  shape.merge_end = true;
+  const auto *query = cache.Get(shape);
+  EXPECT_EQ(query->statement,
+            "UNWIND range(0, size($batch) - 1) AS i WITH i, $batch[i] AS row "
+            "MATCH (u:`Person`) WHERE u.`id` = row[0] MERGE (v:`Company` "
+            "{`id`: row[1]}) CREATE (u)-[:`WORKS_AT`]->(v) RETURN i, "
+            "COUNT(u);");
+  EXPECT_TRUE(query->merge_end);
+}
+
+TEST(QueryShapeCache, StatementsAreCompiledOnce) {
+  QueryShapeCache cache;
+  NodeShape node_shape;
+  node_shape.labels = {"Person"};
+  const auto *node_query = cache.Get(node_shape);
+  EXPECT_EQ(cache.Get(node_shape), node_query);
+  node_shape.properties = {"id"};
+  EXPECT_NE(cache.Get(node_shape), node_query);
+
+  const auto shape = MakeRelationshipShape();
+  const auto *query = cache.Get(shape);
+  EXPECT_EQ(cache.Get(shape), query);
+  auto merged_shape = shape;
+  merged_shape.use_merge = true;
+  EXPECT_NE(cache.Get(merged_shape), query);
+}
+
+TEST(QueryShapeCacheDeathTest, MergedRelationshipsWithPropertyMap) {
+  QueryShapeCache cache;
+  auto shape = MakeRelationshipShape();
+  shape.use_merge = true;
+  shape.property_map = true;
+  EXPECT_DEATH(cache.Get(shape), "");
+}
+
+TEST(GetLoadCsvStatement, Nodes) {
+  NodeShape shape;
+  shape.labels = {"Person"};
+  shape.properties = {"id", "name", "nothing"};
+  EXPECT_EQ(GetLoadCsvNodesStatement(
+                shape,
+                {CsvColumnType::kInt, CsvColumnType::kString,
+                 CsvColumnType::kNull},
+                "/data/people.csv"),
+            "LOAD CSV FROM \"/data/people.csv\" WITH HEADER AS row CREATE "
+            "(u:`Person` {`id`: CASE row.c0 WHEN '' THEN null ELSE "
+            "toInteger(row.c0) END, `name`: CASE row.c1 WHEN '' THEN null ELSE "
+            "substring(row.c1, 1) END}) RETURN COUNT(*);");
+}
+
+TEST(GetLoadCsvStatement, Relationships) {
+  auto shape = MakeRelationshipShape();
+  shape.properties = {"weight", "active"};
+  EXPECT_EQ(GetLoadCsvRelationshipsStatement(
+                shape,
+                {CsvColumnType::kInt, CsvColumnType::kString,
+                 CsvColumnType::kDouble, CsvColumnType::kBool},
+                "/data/works_at.csv"),
+            "LOAD CSV FROM \"/data/works_at.csv\" WITH HEADER AS row MATCH "
+            "(u:`Person`), (v:`Company`) WHERE u.`id` = CASE row.c0 WHEN '' "
+            "THEN null ELSE toInteger(row.c0) END AND v.`id` = CASE row.c1 "
+            "WHEN '' THEN null ELSE substring(row.c1, 1) END CREATE "
+            "(u)-[:`WORKS_AT` {`weight`: CASE row.c2 WHEN '' THEN null ELSE "
+            "toFloat(row.c2) END, `active`: CASE row.c3 WHEN '' THEN null ELSE "
+            "row.c3 = 'true' END}]->(v) RETURN COUNT(*);");
+}
+
+TEST(GetLoadCsvStatement, PathIsEscaped) {
+  NodeShape shape;
+  shape.labels = {"Person"};
+  EXPECT_EQ(GetLoadCsvNodesStatement(shape, {}, "/data/a\"b\\c.csv"),
+            "LOAD CSV FROM \"/data/a\\\"b\\\\c.csv\" WITH HEADER AS row "
+            "CREATE (u:`Person` {}) RETURN COUNT(*);");
+}
+
+TEST(GetLoadCsvStatement, ReturnsLoadedCount) {
+  // Rows whose endpoints are missing are caught by the returned count.
+  auto shape = MakeRelationshipShape();
+  const std::vector<CsvColumnType> types{CsvColumnType::kInt,
+                                         CsvColumnType::kInt};
+  EXPECT_EQ(GetLoadCsvRelationshipsStatement(shape, types, "/data/a.csv"),
+            "LOAD CSV FROM \"/data/a.csv\" WITH HEADER AS row MATCH "
+            "(u:`Person`), (v:`Company`) WHERE u.`id` = CASE row.c0 WHEN '' "
+            "THEN null ELSE toInteger(row.c0) END AND v.`id` = CASE row.c1 "
+            "WHEN '' THEN null ELSE toInteger(row.c1) END CREATE "
+            "(u)-[:`WORKS_AT` {}]->(v) RETURN COUNT(*);");
+  shape.use_merge = true;
+  EXPECT_EQ(GetLoadCsvRelationshipsStatement(shape, types, "/data/a.csv"),
+            "LOAD CSV FROM \"/data/a.csv\" WITH HEADER AS row MATCH "
+            "(u:`Person`), (v:`Company`) WHERE u.`id` = CASE row.c0 WHEN '' "
+            "THEN null ELSE toInteger(row.c0) END AND v.`id` = CASE row.c1 "
+            "WHEN '' THEN null ELSE toInteger(row.c1) END MERGE "
+            "(u)-[:`WORKS_AT` {}]->(v) RETURN COUNT(*);");
+}
+
+TEST(GetLoadCsvStatementDeathTest, ColumnsDontMatchShape) {
+  NodeShape shape;
+  shape.labels = {"Person"};
+  shape.properties = {"id"};
+  EXPECT_DEATH(GetLoadCsvNodesStatement(shape, {}, "/data/people.csv"), "");
+}
+
+TEST(EstimateValueSize, Scalars) {
+  EXPECT_EQ(EstimateValueSize(mg::Value().AsConstValue()), 1);
+  EXPECT_EQ(EstimateValueSize(mg::Value(true).AsConstValue()), 1);
+  EXPECT_EQ(EstimateValueSize(mg::Value(int64_t{1}).AsConstValue()), 8);
+  EXPECT_EQ(EstimateValueSize(mg::Value(1.5).AsConstValue()), 8);
+  EXPECT_EQ(EstimateValueSize(mg::Value("text").AsConstValue()), 4);
+}
+
+TEST(EstimateValueSize, Containers) {
+  mg::Map map(1);
+  map.Insert("key", mg::Value(int64_t{1}));
+  mg::List list(2);
+  list.Append(mg::Value("ab"));
+  list.Append(mg::Value(std::move(map)));
+  EXPECT_EQ(EstimateValueSize(mg::Value(std::move(list)).AsConstValue()),
+            2 + 3 + 8);
+}
@@ -0,0 +1,135 @@
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "memory_monitor.hpp"
+
+namespace {
+
+using std::chrono::milliseconds;
+using std::chrono::seconds;
+
+/// Client which reports the given memory usage as storage info, and counts
+/// the requests to free memory.
+class FakeClient : public MemgraphClient {
+ public:
+  FakeClient(std::atomic<int64_t> *usage, std::atomic<size_t> *freed)
+      : usage_(usage), freed_(freed) {}
+
+  bool Execute(const std::string &statement) override {
+    rows_.clear();
+    if (statement == "SHOW STORAGE INFO;") {
+      rows_.push_back({mg::Value("memory_tracked"), mg::Value(usage_->load())});
+    } else if (statement == "FREE MEMORY;") {
+      ++*freed_;
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+  bool Execute(const std::string &, const mg::ConstMap &) override {
+    return false;
+  }
+
+  std::optional<std::vector<mg::Value>> FetchOne() override {
+    if (rows_.empty()) {
+      return std::nullopt;
+    }
+    auto row = std::move(rows_.back());
+    rows_.pop_back();
+    return row;
+  }
+
+  bool Begin() override { return false; }
+
+  bool Commit() override { return false; }
+
+  bool Rollback() override { return false; }
+
+ private:
+  std::atomic<int64_t> *usage_;
+  std::atomic<size_t> *freed_;
+  std::vector<std::vector<mg::Value>> rows_;
+};
+
+/// Returns whether `condition` holds within a second.
+template <typename Condition>
+bool Eventually(Condition condition) {
+  const auto deadline = std::chrono::steady_clock::now() + seconds(1);
+  while (!condition()) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(milliseconds(1));
+  }
+  return true;
+}
+
+}  // namespace
+
+TEST(ParseMemory, Integers) {
+  EXPECT_EQ(ParseMemory(mg::Value(int64_t{0})), 0);
+  EXPECT_EQ(ParseMemory(mg::Value(int64_t{1234})), 1234);
+  EXPECT_EQ(ParseMemory(mg::Value(int64_t{-1})), std::nullopt);
+}
+
+TEST(ParseMemory, Units) {
+  EXPECT_EQ(ParseMemory(mg::Value("512")), 512);
+  EXPECT_EQ(ParseMemory(mg::Value("512B")), 512);
+  EXPECT_EQ(ParseMemory(mg::Value("2KiB")), 2048);
+  EXPECT_EQ(ParseMemory(mg::Value("2KB")), 2048);
+  EXPECT_EQ(ParseMemory(mg::Value("1.50MiB")), 1572864);
+  EXPECT_EQ(ParseMemory(mg::Value("1.50GiB")), 1610612736);
+  EXPECT_EQ(ParseMemory(mg::Value("1 TiB")), 1099511627776);
+}
+
+TEST(ParseMemory, Invalid) {
+  EXPECT_EQ(ParseMemory(mg::Value()), std::nullopt);
+  EXPECT_EQ(ParseMemory(mg::Value(1.5)), std::nullopt);
+  EXPECT_EQ(ParseMemory(mg::Value("")), std::nullopt);
+  EXPECT_EQ(ParseMemory(mg::Value("GiB")), std::nullopt);
+  EXPECT_EQ(ParseMemory(mg::Value("1PiB")), std::nullopt);
+  EXPECT_EQ(ParseMemory(mg::Value("-1GiB")), std::nullopt);
+}
+
+TEST(MemoryMonitor, PausesAboveThreshold) {
+  std::atomic<int64_t> usage{100};
+  std::atomic<size_t> freed{0};
+  MemoryMonitor monitor(std::make_unique<FakeClient>(&usage, &freed), 0.5,
+                        1000, milliseconds(1), seconds(0));
+  monitor.WaitForMemory();
+
+  usage = 600;
+  ASSERT_TRUE(Eventually([&freed] { return freed > 0; }));
+  std::atomic<bool> resumed{false};
+  std::thread writer([&monitor, &resumed] {
+    monitor.WaitForMemory();
+    resumed = true;
+  });
+  // Writes resume only below 90% of the threshold.
+  usage = 460;
+  std::this_thread::sleep_for(milliseconds(20));
+  EXPECT_FALSE(resumed);
+  usage = 400;
+  EXPECT_TRUE(Eventually([&resumed] { return resumed.load(); }));
+  writer.join();
+}
+
+TEST(MemoryMonitorDeathTest, PauseIsBounded) {
+  EXPECT_DEATH(
+      {
+        std::atomic<int64_t> usage{600};
+        std::atomic<size_t> freed{0};
+        MemoryMonitor monitor(std::make_unique<FakeClient>(&usage, &freed),
+                              0.5, 1000, milliseconds(1), seconds(1));
+        std::this_thread::sleep_for(seconds(3));
+      },
+      "");
+}
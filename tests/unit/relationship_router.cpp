@@ -0,0 +1,156 @@
+#include <set>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "batch_writer.hpp"
+
+namespace {
+
+/// Returns a compiled query of relationships between nodes matched by a
+/// single id property, or merged at the end if `merge_end` is set.
+const CompiledQuery *GetQuery(QueryShapeCache *cache, bool merge_end = false) {
+  RelationshipShape shape;
+  shape.label1 = "Person";
+  shape.id1 = {"id"};
+  shape.label2 = "Company";
+  shape.id2 = {"id"};
+  shape.edge_type = "WORKS_AT";
+  shape.merge_end = merge_end;
+  return cache->Get(shape);
+}
+
+mg::List MakeRow(int64_t from, int64_t to) {
+  return mg::List(std::vector<mg::Value>{mg::Value(from), mg::Value(to)});
+}
+
+}  // namespace
+
+TEST(RelationshipRouter, SingleLane) {
+  QueryShapeCache cache;
+  const auto &query = *GetQuery(&cache);
+  RelationshipRouter router(1, 1000);
+  EXPECT_FALSE(router.counts_degrees());
+  for (int64_t i = 0; i < 10; ++i) {
+    EXPECT_EQ(router.Route(query, MakeRow(i, i + 1)), 0);
+  }
+}
+
+TEST(RelationshipRouter, CountsDegreesOnlyWithSupernodeLane) {
+  EXPECT_FALSE(RelationshipRouter(2, 1000).counts_degrees());
+  EXPECT_FALSE(RelationshipRouter(4, 0).counts_degrees());
+  EXPECT_TRUE(RelationshipRouter(3, 1000).counts_degrees());
+}
+
+TEST(RelationshipRouter, FollowsEndNodesWithoutDegrees) {
+  QueryShapeCache cache;
+  const auto &query = *GetQuery(&cache);
+  RelationshipRouter router(4, 0);
+  std::set<size_t> lanes;
+  for (int64_t to = 0; to < 100; ++to) {
+    const auto lane = router.Route(query, MakeRow(0, to));
+    ASSERT_LT(lane, 4);
+    lanes.insert(lane);
+    // Relationships of the same end node share the lane.
+    for (int64_t from = 1; from < 5; ++from) {
+      EXPECT_EQ(router.Route(query, MakeRow(from, to)), lane);
+    }
+  }
+  // The first node isn't a supernode, since degrees aren't counted.
+  EXPECT_EQ(lanes.size(), 4);
+}
+
+TEST(RelationshipRouter, SupernodesGetTheLastLane) {
+  QueryShapeCache cache;
+  const auto &query = *GetQuery(&cache);
+  RelationshipRouter router(4, 3);
+  // Node 0 is a supernode with 10 relationships, while the others have one.
+  for (int64_t to = 1; to <= 10; ++to) {
+    router.Count(query, MakeRow(0, to));
+  }
+  for (int64_t from = 100; from < 200; ++from) {
+    router.Count(query, MakeRow(from, from + 1000));
+  }
+
+  for (int64_t to = 1; to <= 10; ++to) {
+    EXPECT_EQ(router.Route(query, MakeRow(0, to)), 3);
+  }
+  std::set<size_t> lanes;
+  for (int64_t from = 100; from < 200; ++from) {
+    const auto lane = router.Route(query, MakeRow(from, from + 1000));
+    EXPECT_LT(lane, 3);
+    lanes.insert(lane);
+  }
+  EXPECT_EQ(lanes.size(), 3);
+}
+
+TEST(RelationshipRouter, FollowsHigherDegreeEndpoint) {
+  QueryShapeCache cache;
+  const auto &query = *GetQuery(&cache);
+  RelationshipRouter router(4, 1000);
+  // Node 0 starts more relationships than any of their end nodes has, so
+  // all of them follow it to the same lane.
+  for (int64_t to = 1; to <= 20; ++to) {
+    router.Count(query, MakeRow(0, to));
+  }
+  const auto lane = router.Route(query, MakeRow(0, 1));
+  EXPECT_LT(lane, 3);
+  for (int64_t to = 1; to <= 20; ++to) {
+    EXPECT_EQ(router.Route(query, MakeRow(0, to)), lane);
+  }
+}
+
+TEST(RelationshipRouter, LanesAreStable) {
+  QueryShapeCache cache;
+  const auto &query = *GetQuery(&cache);
+  RelationshipRouter router(5, 2);
+  for (int64_t i = 0; i < 50; ++i) {
+    router.Count(query, MakeRow(i % 7, i % 11));
+  }
+  std::vector<size_t> lanes;
+  for (int64_t i = 0; i < 50; ++i) {
+    lanes.push_back(router.Route(query, MakeRow(i % 7, i % 11)));
+  }
+  for (int64_t i = 0; i < 50; ++i) {
+    EXPECT_EQ(router.Route(query, MakeRow(i % 7, i % 11)), lanes[i]);
+  }
+}
+
+TEST(RelationshipRouter, MergedEndNodesFollowTheirKey) {
+  QueryShapeCache cache;
+  const auto &query = *GetQuery(&cache, true);
+  RelationshipRouter router(4, 1);
+  for (int64_t from = 0; from < 10; ++from) {
+    router.Count(query, MakeRow(from, 42));
+  }
+  // The same ghost is always merged by the same lane, even if it's a
+  // supernode.
+  const auto lane = router.Route(query, MakeRow(0, 42));
+  for (int64_t from = 1; from < 10; ++from) {
+    EXPECT_EQ(router.Route(query, MakeRow(from, 42)), lane);
+  }
+}
+
+TEST(RelationshipRouter, ManyNodesAreNotSupernodes) {
+  QueryShapeCache cache;
+  const auto &query = *GetQuery(&cache);
+  RelationshipRouter router(4, 10);
+  // Degrees are counted in bounded memory, which overestimates them only
+  // slightly for this many distinct nodes.
+  const int64_t kRelationships = 200000;
+  for (int64_t i = 0; i < kRelationships; ++i) {
+    router.Count(query, MakeRow(i, i));
+  }
+  for (int64_t i = 0; i < kRelationships; ++i) {
+    ASSERT_LT(router.Route(query, MakeRow(i, i)), 3);
+  }
+}
+
+TEST(RelationshipRouterDeathTest, CountingAfterRouting) {
+  QueryShapeCache cache;
+  const auto &query = *GetQuery(&cache);
+  RelationshipRouter router(4, 10);
+  router.Route(query, MakeRow(0, 1));
+  EXPECT_DEATH(router.Count(query, MakeRow(0, 1)), "");
+}
@@ -0,0 +1,71 @@
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "row_binding.hpp"
+
+namespace {
+
+std::vector<mg::Value> MakeRow(const std::vector<std::string> &values) {
+  std::vector<mg::Value> row;
+  for (const auto &value : values) {
+    row.emplace_back(value);
+  }
+  return row;
+}
+
+}  // namespace
+
+TEST(PlanBindings, MovesOnlyLastUse) {
+  const auto plans = PlanBindings({{0, 1}, {1, 2}, {2, 3}});
+  ASSERT_EQ(plans.size(), 3);
+  EXPECT_EQ(plans[0][0].position, 0);
+  EXPECT_TRUE(plans[0][0].move);
+  EXPECT_EQ(plans[0][1].position, 1);
+  EXPECT_FALSE(plans[0][1].move);
+  EXPECT_TRUE(plans[1][0].move);
+  EXPECT_FALSE(plans[1][1].move);
+  EXPECT_TRUE(plans[2][0].move);
+  EXPECT_TRUE(plans[2][1].move);
+}
+
+TEST(PlanBindings, RepeatedPositionInSameQuery) {
+  const auto plans = PlanBindings({{0, 0}});
+  ASSERT_EQ(plans.size(), 1);
+  EXPECT_FALSE(plans[0][0].move);
+  EXPECT_TRUE(plans[0][1].move);
+}
+
+TEST(PlanBindings, NoQueries) { EXPECT_TRUE(PlanBindings({}).empty()); }
+
+TEST(BindRow, BindsInPlanOrder) {
+  auto row = MakeRow({"a", "b", "c"});
+  const auto plans = PlanBindings({{2, 0}});
+  const auto values = BindRow(&row, plans[0]);
+  ASSERT_EQ(values.size(), 2);
+  EXPECT_EQ(values[0].ValueString(), "c");
+  EXPECT_EQ(values[1].ValueString(), "a");
+}
+
+TEST(BindRow, MovedValuesAreNotCopied) {
+  // Strings are long enough not to fit any small buffer, so a copy would
+  // allocate a new one.
+  const std::string shared(64, 's');
+  const std::string single(64, 'x');
+  auto row = MakeRow({shared, single});
+  const auto *shared_data = row[0].ValueString().data();
+  const auto *single_data = row[1].ValueString().data();
+
+  const auto plans = PlanBindings({{0}, {0, 1}});
+  const auto first = BindRow(&row, plans[0]);
+  const auto second = BindRow(&row, plans[1]);
+
+  // The shared value is copied on the first use, and moved on the last one.
+  ASSERT_EQ(first.size(), 1);
+  EXPECT_EQ(first[0].ValueString(), shared);
+  EXPECT_NE(first[0].ValueString().data(), shared_data);
+  ASSERT_EQ(second.size(), 2);
+  EXPECT_EQ(second[0].ValueString().data(), shared_data);
+  EXPECT_EQ(second[1].ValueString().data(), single_data);
+}
@@ -0,0 +1,95 @@
+#include <set>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "shard_map.hpp"
+
+namespace {
+
+mg::List MakeRow(std::vector<mg::Value> values) {
+  return mg::List(std::move(values));
+}
+
+}  // namespace
+
+TEST(ShardMap, LabelShardsTakePrecedence) {
+  const ShardMap shard_map(3, {{"Person", 2}});
+  EXPECT_TRUE(shard_map.has_label_shards());
+  EXPECT_EQ(shard_map.GetLabelShard("Person"), 2);
+  EXPECT_EQ(shard_map.GetLabelShard("Company"), std::nullopt);
+  for (int64_t id = 0; id < 100; ++id) {
+    EXPECT_EQ(shard_map.GetShard("Person", id), 2);
+  }
+  const auto row = MakeRow({mg::Value("x"), mg::Value(int64_t{1})});
+  EXPECT_EQ(shard_map.GetShard("Person", row, {0, 1}), 2);
+}
+
+TEST(ShardMap, SingleShard) {
+  const ShardMap shard_map(1, {});
+  EXPECT_FALSE(shard_map.has_label_shards());
+  for (int64_t id = 0; id < 100; ++id) {
+    EXPECT_EQ(shard_map.GetShard("Person", id), 0);
+  }
+}
+
+TEST(ShardMap, IdAndRowKeysMatch) {
+  const ShardMap shard_map(7, {});
+  for (int64_t id = 0; id < 100; ++id) {
+    const auto row = MakeRow({mg::Value("ignored"), mg::Value(id)});
+    EXPECT_EQ(shard_map.GetShard("Person", row, {1}),
+              shard_map.GetShard("Person", id));
+  }
+}
+
+TEST(ShardMap, KeyOrderDoesntMatter) {
+  const ShardMap shard_map(5, {});
+  for (int64_t id = 0; id < 100; ++id) {
+    const auto row =
+        MakeRow({mg::Value(id), mg::Value("key" + std::to_string(id))});
+    EXPECT_EQ(shard_map.GetShard("Person", row, {0, 1}),
+              shard_map.GetShard("Person", row, {1, 0}));
+  }
+}
+
+TEST(ShardMap, KeysAreSpreadAcrossShards) {
+  const ShardMap shard_map(4, {});
+  std::set<size_t> shards;
+  for (int64_t id = 0; id < 1000; ++id) {
+    const auto shard = shard_map.GetShard("Person", id);
+    ASSERT_LT(shard, 4);
+    shards.insert(shard);
+  }
+  EXPECT_EQ(shards.size(), 4);
+}
+
+TEST(ShardMap, LabelIsPartOfTheKey) {
+  const ShardMap shard_map(16, {});
+  size_t different = 0;
+  for (int64_t id = 0; id < 100; ++id) {
+    different +=
+        shard_map.GetShard("Person", id) != shard_map.GetShard("Company", id);
+  }
+  EXPECT_GT(different, 0);
+}
+
+TEST(ShardMapDeathTest, LabelShardOutOfRange) {
+  EXPECT_DEATH(ShardMap(2, {{"Person", 2}}), "");
+}
+
+TEST(ParseLabelShards, Empty) { EXPECT_TRUE(ParseLabelShards("").empty()); }
+
+TEST(ParseLabelShards, Pairs) {
+  const auto label_shards = ParseLabelShards("Person=0,Company=1,A=B=2");
+  const std::map<std::string, size_t> expected{
+      {"Person", 0}, {"Company", 1}, {"A=B", 2}};
+  EXPECT_EQ(label_shards, expected);
+}
+
+TEST(ParseLabelShardsDeathTest, Malformed) {
+  EXPECT_DEATH(ParseLabelShards("Person"), "");
+  EXPECT_DEATH(ParseLabelShards("=1"), "");
+  EXPECT_DEATH(ParseLabelShards("Person=x"), "");
+  EXPECT_DEATH(ParseLabelShards("Person=1x"), "");
+}